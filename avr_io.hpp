@@ -4,8 +4,11 @@
  * Contains abstractions for:
  *     Digital input pins.
  *     Digital output pins.
- *     Debounced push buttons.
- *     Seven segment displays.
+ *     Debounced push buttons, individually or a whole bank at once.
+ *     Tap, double tap, long press and chord gestures.
+ *     Timestamped pin change capture and a millisecond clock.
+ *     Seven segment displays and fonts.
+ *     Interrupt driven serial port.
  *
  * @author Aaron Jones <aaron@jonesinator.com>
  * @license GPLv3
@@ -14,153 +17,232 @@
 #ifndef __AVR_IO_HPP__
 #define __AVR_IO_HPP__
 
-#include <util/delay.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdint.h>
+#include <util/atomic.h>
+
+#include "avr_isr_queue.hpp"
 
 /**
- * The GPIO pin banks on AVR are controlled by three different registers. This
- * structure simply stores the addresses of the three related registers for a
- * particular bank.
+ * The GPIO pin banks on AVR are controlled by three different registers. These
+ * structures give compile-time access to the three related registers for a
+ * particular bank. Since the register addresses are known at compile time, pin
+ * operations on them compile down to single sbi/cbi/sbis instructions.
  */
-struct avr_io_bank {
+#ifdef PORTB
+struct avr_io_bank_b {
     /**
      * The Data Direction Register for the port.
      */
-    volatile uint8_t* const ddr;
+    static volatile uint8_t& ddr() { return DDRB; }
 
     /**
      * The port control. For output pins it controls the output state, for input
      * pins it controls whether or not the internal pull-up register is enabled.
      */
-    volatile uint8_t* const port;
+    static volatile uint8_t& port() { return PORTB; }
 
     /**
      * The input register. Used to read the state of input pins.
      */
-    volatile uint8_t* const pin;
+    static volatile uint8_t& pin() { return PINB; }
+
+#ifdef PCMSK0
+    /**
+     * The pin change mask register, selects which pins in the bank trigger the
+     * bank's pin change interrupt.
+     */
+    static volatile uint8_t& pcmsk() { return PCMSK0; }
+
+    /**
+     * The bit in PCICR that enables the bank's pin change interrupt.
+     */
+    static constexpr uint8_t PCIE = PCIE0;
+#endif
+};
+#endif
+
+#ifdef PORTC
+/**
+ * Registers for I/O bank C, see avr_io_bank_b.
+ */
+struct avr_io_bank_c {
+    static volatile uint8_t& ddr() { return DDRC; }
+    static volatile uint8_t& port() { return PORTC; }
+    static volatile uint8_t& pin() { return PINC; }
+#ifdef PCMSK1
+    static volatile uint8_t& pcmsk() { return PCMSK1; }
+    static constexpr uint8_t PCIE = PCIE1;
+#endif
+};
+#endif
+
+#ifdef PORTD
+/**
+ * Registers for I/O bank D, see avr_io_bank_b.
+ */
+struct avr_io_bank_d {
+    static volatile uint8_t& ddr() { return DDRD; }
+    static volatile uint8_t& port() { return PORTD; }
+    static volatile uint8_t& pin() { return PIND; }
+#ifdef PCMSK2
+    static volatile uint8_t& pcmsk() { return PCMSK2; }
+    static constexpr uint8_t PCIE = PCIE2;
+#endif
 };
+#endif
 
 /**
  * Abstraction for an digital input pin. This is often a building block for
- * higher-level input constructs (debounced buttons, etc.) Nothing prevents
- * multiple objects being created for the same pin, the client must ensure
- * that this does not happen.
+ * higher-level input constructs (debounced buttons, etc.) The pin is fully
+ * described by its type, so it has no state and all of its functions are
+ * static. Nothing prevents multiple types being created for the same pin, the
+ * client must ensure that this does not happen.
+ *
+ * @tparam bank_t    The pin bank that houses this input pin, e.g.
+ *                   avr_io_bank_d.
+ * @tparam bit_t     The bit (0-7) in the bank that controls this input pin.
+ * @tparam pull_up_t True if the internal pull-up should be enabled, false
+ *                   otherwise.
  */
+template <typename bank_t, uint8_t bit_t, bool pull_up_t>
 struct avr_digital_input_pin {
+    static_assert(bit_t < 8, "AVR I/O banks only have eight pins.");
+
     /**
-     * Initializes a particular pin as input, optionally enabling the pull-up
-     * register.
-     *
-     * @param bank    The pin bank that houses this input pin.
-     * @param bit     The bit (0-7) in the bank that controls this input pin.
-     * @param pull_up True if the internal pull-up should be enabled, false
-     *                otherwise.
+     * The pin bank that houses this input pin.
+     */
+    using bank = bank_t;
+
+    /**
+     * The bit in the bank that controls this input pin.
+     */
+    static constexpr uint8_t BIT = bit_t;
+
+    /**
+     * The bitmask used to single out just this input pin in the control
+     * registers.
+     */
+    static constexpr uint8_t MASK = 1 << bit_t;
+
+    /**
+     * Initializes the pin as input, optionally enabling the pull-up register.
      */
-    avr_digital_input_pin(avr_io_bank& bank, uint8_t bit, bool pull_up):
-        _bank(bank),
-        _mask(1 << bit),
-        _pull_up(pull_up) {
+    static void init() {
         /**
          * Enable the pin as input by clearing its bit in the data direction
          * register.
          */
-        *_bank.ddr &= ~_mask;
-        if (_pull_up) {
+        bank_t::ddr() &= ~MASK;
+        if (pull_up_t) {
             /**
              * Enable the internal pull-up by setting its bit in the port
              * register.
              */
-            *_bank.port |= _mask;
+            bank_t::port() |= MASK;
         }
     }
 
     /**
      * Gets the current state of this input pin.
+     *
+     * @returns True if the input is high, false if the input is low.
      */
-    bool read() const {
-        return *_bank.pin & _mask;
+    static bool read() {
+        return bank_t::pin() & MASK;
     }
 
     /**
      * Determines whether or not the pull-up register is enabled for this pin.
      *
-     * @returns True if the input is high, false if the input is low.
+     * @returns True if the pull-up is enabled, false otherwise.
      */
-    bool pull_up() const {
-        return _pull_up;
+    static constexpr bool pull_up() {
+        return pull_up_t;
     }
+};
 
-private:
+/**
+ * A digital output pin that doesn't actually do anything. This exists so we can
+ * have output pins that are needed to satisfy an interface but aren't wired to
+ * anything, for example a seven segment display where the decimal point pin is
+ * unused.
+ */
+struct avr_digital_output_pin_null {
     /**
-     * The pin bank containing this input pin.
+     * The null pin is not in any bank.
      */
-    const avr_io_bank& _bank;
+    using bank = void;
 
     /**
-     * The bitmask used to single out just this input pin in the control
-     * registers.
+     * The null pin has no bit, this just satisfies the output pin traits.
      */
-    const uint8_t _mask;
+    static constexpr uint8_t BIT = 0;
 
     /**
-     * Whether or not the internal pull-up is enabled. True if the pull-up is
-     * enabled, false if the pull-up is not enabled.
+     * True, since setting this pin has no effect.
      */
-    const bool _pull_up;
-};
+    static constexpr bool IS_NULL = true;
 
-/**
- * Abstract interface for digital output pins. This abstraction exists so we can
- * have output pins that don't actually anything, but are needed to satisfy an
- * interface, for example a seven segment display where the decimal point pin is
- * unused.
- */
-struct avr_digital_output_pin_interface {
-    virtual void set(bool high) const = 0;
-};
-
-/**
- * A digital output pin that doesn't actually do anything.
- */
-struct avr_digital_output_pin_null : avr_digital_output_pin_interface {
     /**
-     * Get a singleton instance of the null digital output pin.
-     *
-     * @returns The singleton instance of the null digital output pin.
+     * "Initializes" the null digital output pin, doesn't actually do anything.
      */
-    static avr_digital_output_pin_null& instance() {
-        static avr_digital_output_pin_null pin;
-        return pin;
+    static void init() {
     }
 
     /**
      * "Sets" the state of the null digital output pin, doesn't actually do
      * anything, this just satisfies the digital output pin interface.
      */
-    virtual void set(bool) const override {
+    static void set(bool) {
     }
 };
 
 /**
  * Abstraction for a digital output pin. This is often a building block for
- * higher-level input constructs (seven segment displays, etc.) Nothing
- * prevents multiple objects being created for the same pin, the client must
- * ensure that this does not happen.
+ * higher-level input constructs (seven segment displays, etc.) The pin is fully
+ * described by its type, so it has no state and all of its functions are
+ * static. Nothing prevents multiple types being created for the same pin, the
+ * client must ensure that this does not happen.
+ *
+ * @tparam bank_t The pin bank that houses this output pin, e.g. avr_io_bank_d.
+ * @tparam bit_t  The bit (0-7) in the bank that controls this output pin.
  */
-struct avr_digital_output_pin : avr_digital_output_pin_interface {
+template <typename bank_t, uint8_t bit_t>
+struct avr_digital_output_pin {
+    static_assert(bit_t < 8, "AVR I/O banks only have eight pins.");
+
     /**
-     * Initializes a particular pin as output.
-     *
-     * @param bank    The pin bank that houses this input pin.
-     * @param bit     The bit (0-7) in the bank that controls this input pin.
+     * The pin bank that houses this output pin.
+     */
+    using bank = bank_t;
+
+    /**
+     * The bit in the bank that controls this output pin.
+     */
+    static constexpr uint8_t BIT = bit_t;
+
+    /**
+     * False, since this pin actually drives something.
+     */
+    static constexpr bool IS_NULL = false;
+
+    /**
+     * The bitmask used to single out just this output pin in the control
+     * registers.
+     */
+    static constexpr uint8_t MASK = 1 << bit_t;
+
+    /**
+     * Initializes the pin as output.
      */
-    avr_digital_output_pin(avr_io_bank& bank, uint8_t bit):
-        _bank(bank),
-        _mask(1 << bit) {
+    static void init() {
         /**
          * Enable the pin as output by setting its bit in the data direction
          * register.
          */
-        *_bank.ddr |= _mask;
+        bank_t::ddr() |= MASK;
     }
 
     /**
@@ -169,59 +251,135 @@ struct avr_digital_output_pin : avr_digital_output_pin_interface {
      * @param high True if the pin should be set to high, false if the pin
      *             should be set to low.
      */
-    virtual void set(bool high) const override {
+    static void set(bool high) {
         if (high) {
-            *_bank.port |= _mask;
+            bank_t::port() |= MASK;
         } else {
-            *_bank.port &= ~_mask;
+            bank_t::port() &= ~MASK;
         }
     }
+};
 
-private:
+/**
+ * Compile-time test for whether two types are the same type.
+ */
+template <typename a_t, typename b_t>
+struct avr_is_same {
+    static constexpr bool value = false;
+};
+
+template <typename a_t>
+struct avr_is_same<a_t, a_t> {
+    static constexpr bool value = true;
+};
+
+/**
+ * Compile-time boolean used to select between function overloads.
+ */
+template <bool value_t>
+struct avr_bool_constant {
+};
+
+/**
+ * A list of digital output pins that can be addressed by a runtime index. Since
+ * the pins are compile-time types, set() compiles to a short chain of
+ * comparisons and sbi/cbi instructions rather than indirect calls.
+ *
+ * @tparam pins_t The output pins, in index order.
+ */
+template <typename ...pins_t>
+struct avr_digital_output_pin_list;
+
+/**
+ * The empty pin list, terminates the recursion.
+ */
+template <>
+struct avr_digital_output_pin_list<> {
+    static constexpr uint8_t SIZE = 0;
+
+    static void init() {
+    }
+
+    static void set(uint8_t, bool) {
+    }
+};
+
+template <typename first_t, typename ...rest_t>
+struct avr_digital_output_pin_list<first_t, rest_t...> {
     /**
-     * The pin bank containing this input pin.
+     * The number of pins in the list.
      */
-    const avr_io_bank& _bank;
+    static constexpr uint8_t SIZE = 1 + sizeof...(rest_t);
 
     /**
-     * The bitmask used to single out just this input pin in the control
-     * registers.
+     * Initializes every pin in the list as output.
+     */
+    static void init() {
+        first_t::init();
+        avr_digital_output_pin_list<rest_t...>::init();
+    }
+
+    /**
+     * Sets the output state of one pin in the list.
+     *
+     * @param index The index of the pin to set. Out of range indices are
+     *              ignored.
+     * @param high  True if the pin should be set to high, false if the pin
+     *              should be set to low.
      */
-    const uint8_t _mask;
+    static void set(uint8_t index, bool high) {
+        if (index == 0) {
+            first_t::set(high);
+        } else {
+            avr_digital_output_pin_list<rest_t...>::set(index - 1, high);
+        }
+    }
 };
 
 /**
- * Wrapper around an input pin that performs simple debouncing logic.
+ * Enumeration for the possible states of a button and whether or not the button
+ * has changed states.
  */
-struct avr_button {
+enum class avr_button_action {
     /**
-     * Enumeration for the possible states of the button and whether or not the
-     * button has changed states.
+     * The button has not changed states since the last time it was checked.
      */
-    enum class action {
-        /**
-         * The button has not changed states since the last time it was checked.
-         */
-        none,
+    none,
 
-        /**
-         * The button is currently pressed (state) or has just changed to
-         * pressed (check).
-         */
-        pressed,
+    /**
+     * The button is currently pressed (state) or has just changed to pressed
+     * (check).
+     */
+    pressed,
 
-        /**
-         * The button is currently released (state) or has just changed to
-         * released (check).
-         */
-        released
-    };
+    /**
+     * The button is currently released (state) or has just changed to released
+     * (check).
+     */
+    released
+};
+
+/**
+ * Wrapper around an input pin that performs simple debouncing logic. A change
+ * is accepted once three consecutive calls to check() read the same state, so
+ * the debounce time depends on how often check() is called. Use an
+ * avr_edge_debouncer fed with avr_millis_clock timestamps to debounce over a
+ * fixed time instead.
+ *
+ * @tparam input_pin_t The avr_digital_input_pin the button is connected to.
+ */
+template <typename input_pin_t>
+struct avr_button {
+    /**
+     * The possible states of the button, see avr_button_action.
+     */
+    using action = avr_button_action;
 
     /**
-     * Create a button object from an input pin.
+     * Create a button object, initializing its input pin.
      */
-    avr_button(avr_digital_input_pin& input_pin):
-        _input_pin(input_pin) {
+    avr_button() {
+        input_pin_t::init();
     }
 
     /**
@@ -238,12 +396,12 @@ struct avr_button {
          * is enabled then assume that the logic is reversed, i.e. a high
          * reading indicates that the button is not pressed.
          */
-        if (_input_pin.pull_up()) {
-            _states[_counter++ % 3] = _input_pin.read()
+        if (input_pin_t::pull_up()) {
+            _states[_counter++ % 3] = input_pin_t::read()
                                       ? action::released
                                       : action::pressed;
         } else {
-            _states[_counter++ % 3] = _input_pin.read()
+            _states[_counter++ % 3] = input_pin_t::read()
                                       ? action::pressed
                                       : action::released;
         }
@@ -280,11 +438,6 @@ struct avr_button {
     }
 
 private:
-    /**
-     * The underlying input pin representing this button.
-     */
-    const avr_digital_input_pin& _input_pin;
-
     /**
      * A counter that is used to determine the index in the _states array where
      * readings should be placed.
@@ -306,198 +459,1141 @@ private:
 };
 
 /**
- * Bitmasks for each individual segment of seven segment displays.
+ * Combined compile-time properties of a set of input pins that all live in the
+ * same bank.
  *
- *   AA
- *  F  B
- *  F  B
- *   GG
- *  E  C
- *  E  C
- *   DD  DP
+ * @tparam pins_t The avr_digital_input_pin types.
  */
-static constexpr uint8_t SEG_A  = 0b00000001;
-static constexpr uint8_t SEG_B  = 0b00000010;
-static constexpr uint8_t SEG_C  = 0b00000100;
-static constexpr uint8_t SEG_D  = 0b00001000;
-static constexpr uint8_t SEG_E  = 0b00010000;
-static constexpr uint8_t SEG_F  = 0b00100000;
-static constexpr uint8_t SEG_G  = 0b01000000;
-static constexpr uint8_t SEG_DP = 0b10000000;
+template <typename ...pins_t>
+struct avr_digital_input_pin_set;
 
-/**
- * Seven segment patterns for decimal and hexadecimal numbers.
- */
-static constexpr uint8_t SEVSEG[16] = {
-    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F        , /* 0 */
-            SEG_B | SEG_C                                , /* 1 */
-    SEG_A | SEG_B |         SEG_D | SEG_E |         SEG_G, /* 2 */
-    SEG_A | SEG_B | SEG_C | SEG_D |                 SEG_G, /* 3 */
-            SEG_B | SEG_C |                 SEG_F | SEG_G, /* 4 */
-    SEG_A |         SEG_C | SEG_D |         SEG_F | SEG_G, /* 5 */
-                    SEG_C | SEG_D | SEG_E | SEG_F | SEG_G, /* 6 */
-    SEG_A | SEG_B | SEG_C                                , /* 7 */
-    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G, /* 8 */
-    SEG_A | SEG_B | SEG_C |                 SEG_F | SEG_G, /* 9 */
-    SEG_A | SEG_B | SEG_C |         SEG_E | SEG_F | SEG_G, /* A */
-                    SEG_C | SEG_D | SEG_E | SEG_F | SEG_G, /* b */
-    SEG_A |                 SEG_D | SEG_E | SEG_F        , /* C */
-            SEG_B | SEG_C | SEG_D | SEG_E |         SEG_G, /* d */
-    SEG_A |                 SEG_D | SEG_E | SEG_F | SEG_G, /* E */
-    SEG_A |                         SEG_E | SEG_F | SEG_G, /* F */
+template <typename pin_t>
+struct avr_digital_input_pin_set<pin_t> {
+    /**
+     * The bank that houses every pin in the set.
+     */
+    using bank = typename pin_t::bank;
+
+    /**
+     * The bits of every pin in the set.
+     */
+    static constexpr uint8_t MASK = pin_t::MASK;
+
+    /**
+     * The bits of every pin in the set that has its pull-up enabled, and so
+     * reads low when its button is pressed.
+     */
+    static constexpr uint8_t ACTIVE_LOW = pin_t::pull_up() ? pin_t::MASK : 0;
+
+    /**
+     * Initializes every pin in the set.
+     */
+    static void init() {
+        pin_t::init();
+    }
+};
+
+template <typename first_t, typename ...rest_t>
+struct avr_digital_input_pin_set<first_t, rest_t...> {
+    using bank = typename first_t::bank;
+
+    static_assert(avr_is_same<bank, typename avr_digital_input_pin_set<
+                                  rest_t...>::bank>::value,
+                  "All pins in the set must be in the same bank.");
+
+    static constexpr uint8_t MASK =
+        first_t::MASK | avr_digital_input_pin_set<rest_t...>::MASK;
+
+    static constexpr uint8_t ACTIVE_LOW =
+        (first_t::pull_up() ? first_t::MASK : 0) |
+        avr_digital_input_pin_set<rest_t...>::ACTIVE_LOW;
+
+    static void init() {
+        first_t::init();
+        avr_digital_input_pin_set<rest_t...>::init();
+    }
 };
 
 /**
- * Abstraction over the display pins for a seven segment display. This class is
- * not responsible for digit selection, just the segments. This allows multiple
- * seven segment digits to use the same pin set with time mulitplexing.
+ * Debounces every button in one I/O bank at once. Each call to sample() reads
+ * the bank's input register once and advances a two bit counter for every pin
+ * in parallel, the counters being stored "vertically" with one bit of each
+ * counter per byte. A pin's debounced state only changes after four
+ * consecutive samples that all disagree with it, and any sample that agrees
+ * resets its counter. The cost of sample() is the same no matter how many
+ * buttons are in the bank.
+ *
+ * The debounce window is four sample periods, so sample() should be called at
+ * a fixed rate, e.g. every few milliseconds from a timer tick, rather than
+ * once per main loop iteration.
+ *
+ * Pins with their pull-up enabled are treated as active low, i.e. a low reading
+ * means the button is pressed.
+ *
+ * @tparam pins_t The avr_digital_input_pin types of the buttons, which must all
+ *                be in the same bank.
  */
-struct avr_seven_segment_pins {
+template <typename ...pins_t>
+struct avr_port_debouncer {
     /**
-     * Creates a seven segment display controller from the given output pins.
-     *
-     * @param seg_a  The output pin to use for the A segment.
-     * @param seg_b  The output pin to use for the B segment.
-     * @param seg_c  The output pin to use for the C segment.
-     * @param seg_d  The output pin to use for the D segment.
-     * @param seg_e  The output pin to use for the E segment.
-     * @param seg_f  The output pin to use for the F segment.
-     * @param seg_g  The output pin to use for the G segment.
-     * @param seg_dp The output pin to use for the decimal point segment.
+     * The combined properties of the debounced pins.
+     */
+    using pins = avr_digital_input_pin_set<pins_t...>;
+
+    /**
+     * Creates a debouncer, initializing its input pins. Every button starts
+     * out released.
      */
-    avr_seven_segment_pins(const avr_digital_output_pin_interface& seg_a,
-                           const avr_digital_output_pin_interface& seg_b,
-                           const avr_digital_output_pin_interface& seg_c,
-                           const avr_digital_output_pin_interface& seg_d,
-                           const avr_digital_output_pin_interface& seg_e,
-                           const avr_digital_output_pin_interface& seg_f,
-                           const avr_digital_output_pin_interface& seg_g,
-                           const avr_digital_output_pin_interface& seg_dp):
-        _segs{&seg_a, &seg_b, &seg_c, &seg_d, &seg_e, &seg_f, &seg_g, &seg_dp} {
+    avr_port_debouncer() {
+        pins::init();
     }
 
     /**
-     * Outputs a decimal number to the seven segment display pins.
+     * Reads the bank's input register and updates the debounced state of every
+     * pin.
      *
-     * @param number The number to display.
+     * @returns A mask of the pins whose debounced state changed.
      */
-    void display_decimal(uint8_t number) {
-        display_custom(SEVSEG[number % 10]);
+    uint8_t sample() {
+        /**
+         * A set bit means the raw reading disagrees with the debounced state.
+         */
+        uint8_t changed = ((pins::bank::pin() ^ pins::ACTIVE_LOW) & pins::MASK)
+                          ^ _state;
+
+        /**
+         * Count down the counters of disagreeing pins and reset the counters
+         * of agreeing pins to three. A pin toggles when its counter rolls over
+         * from zero back to three.
+         */
+        _count0 = ~(_count0 & changed);
+        _count1 = _count0 ^ (_count1 & changed);
+        changed &= _count0 & _count1;
+
+        _state ^= changed;
+        _pressed = _state & changed;
+        _released = ~_state & changed;
+        return changed;
     }
 
     /**
-     * Outputs a hexadecimal number to the seven segment display pins.
+     * Gets the debounced state of every pin.
      *
-     * @param number The number to display.
+     * @returns A mask with a bit set for every button that is pressed.
      */
-    void display_hex(uint8_t number) {
-        display_custom(SEVSEG[number % 0x10]);
+    uint8_t state() const {
+        return _state;
     }
 
     /**
-     * Sets or clears the output of the decimal point segment.
+     * Gets the buttons that were pressed by the last call to sample().
      *
-     * @param display True to set the decimal point, false to clear it.
+     * @returns A mask with a bit set for every button that changed to pressed.
      */
-    void display_decimal_point(bool display) {
-        if (display) {
-            display_custom(_current_display | SEG_DP);
-        } else {
-            display_custom(_current_display & ~SEG_DP);
-        }
+    uint8_t pressed() const {
+        return _pressed;
     }
 
     /**
-     * Sets all segments to not display.
+     * Gets the buttons that were released by the last call to sample().
+     *
+     * @returns A mask with a bit set for every button that changed to released.
      */
-    void clear() {
-        display_custom(0);
+    uint8_t released() const {
+        return _released;
     }
 
     /**
-     * Displays a custom pattern on the seven segment display.
+     * Determines whether a particular button changed state in the last call to
+     * sample().
      *
-     * @param mask The mask to output to the seven segment display. Use the
-     *             SEG_X constants to control what is displayed.
+     * @tparam pin_t The avr_digital_input_pin of the button.
+     *
+     * @returns action::none if the button's state has not changed,
+     *          action::pressed if the button has just changed to pressed,
+     *          action::released if the button has just changed to released.
      */
-    void display_custom(uint8_t mask) {
-        for (uint8_t i = 0; i < 8; ++i) {
-            _segs[i]->set(mask & (1 << i));
+    template <typename pin_t>
+    avr_button_action check() const {
+        static_assert((pins::MASK & pin_t::MASK) != 0,
+                      "The pin is not handled by this debouncer.");
+        if (_pressed & pin_t::MASK) {
+            return avr_button_action::pressed;
+        } else if (_released & pin_t::MASK) {
+            return avr_button_action::released;
         }
-        _current_display = mask;
+        return avr_button_action::none;
     }
 
 private:
-    const avr_digital_output_pin_interface* const _segs[8];
+    /**
+     * The debounced state, a set bit means the button is pressed.
+     */
+    uint8_t _state = 0;
 
     /**
-     * The mask that is currently being displayed.
+     * The low bit of every pin's counter.
      */
-    uint8_t _current_display = 0;
+    uint8_t _count0 = 0xFF;
+
+    /**
+     * The high bit of every pin's counter.
+     */
+    uint8_t _count1 = 0xFF;
+
+    /**
+     * The pins that changed to pressed in the last sample.
+     */
+    uint8_t _pressed = 0;
+
+    /**
+     * The pins that changed to released in the last sample.
+     */
+    uint8_t _released = 0;
 };
 
 /**
- * Abstraction for a time multiplxed seven segment display with some number
- * of digits and a colon segment. If the display has no colon segment then
- * avr_digital_output_pin_null can be passed.
+ * A snapshot of an I/O bank's input register taken when one of its pins
+ * changed.
+ */
+struct avr_pin_change_event {
+    /**
+     * When the change happened, usually the low 16 bits of an
+     * avr_millis_clock, i.e. in milliseconds.
+     */
+    uint16_t timestamp;
+
+    /**
+     * The value of the bank's input register.
+     */
+    uint8_t pins;
+};
+
+/**
+ * Captures changes of a set of input pins in one I/O bank using the bank's pin
+ * change interrupt. The interrupt handler, which must be defined by the
+ * application, calls capture() with a timestamp, and the main loop takes the
+ * events with pop() and usually feeds them to an avr_edge_debouncer.
  *
- * @tparam num_digits_t The number of digits in the display.
+ * @tparam capacity_t The number of events that can be queued.
+ * @tparam pins_t     The avr_digital_input_pin types to watch, which must all
+ *                    be in the same bank.
  */
-template <uint8_t num_digits_t>
-struct avr_seven_segment_display {
+template <uint8_t capacity_t, typename ...pins_t>
+struct avr_pin_change_capture {
     /**
-     * Creates a seven segment display.
-     *
-     * @tparam digits_t Output pins for each digit.
+     * The combined properties of the watched pins.
+     */
+    using pins = avr_digital_input_pin_set<pins_t...>;
+
+    /**
+     * Creates a capture object, initializing its input pins.
+     */
+    avr_pin_change_capture() {
+        pins::init();
+    }
+
+    /**
+     * Enables the pin change interrupt for the watched pins. Interrupts must
+     * still be enabled globally with sei().
+     */
+    void start() {
+        pins::bank::pcmsk() |= pins::MASK;
+        PCIFR = _BV(pins::bank::PCIE);
+        PCICR |= _BV(pins::bank::PCIE);
+    }
+
+    /**
+     * Records the current state of the bank's input register. Meant to be
+     * called from the bank's pin change interrupt handler. It may also be
+     * called from other interrupt handlers, e.g. to poll the pins from a timer
+     * interrupt, since AVR interrupt handlers do not nest. If the queue is full
+     * the event is dropped.
      *
-     * @param seg    The seven segment pins to use for the display.
-     * @param colon  The output pin to use for the colon segment.
-     * @param digits The output pins to use to select each digit.
+     * @param timestamp The time of the change.
      */
-    template <typename ...digits_t>
-    avr_seven_segment_display(avr_seven_segment_pins& seg,
-                              const avr_digital_output_pin_interface& colon,
-                              digits_t... digits):
-        _seg(seg),
-        _colon(colon),
-        _digits{digits...} {
+    void capture(uint16_t timestamp) {
+        _events.push(avr_pin_change_event { timestamp, pins::bank::pin() });
     }
 
     /**
-     * Display a number in decimal.
+     * Takes the oldest captured event.
      *
-     * @param number        The number to display.
-     * @param decimal_point The digit on which the decimal point segment should
-     *                      be enabled. Use -1 to disable the decimal point.
+     * @param event Set to the oldest captured event.
+     *
+     * @returns True if an event was taken, false if there are no events.
      */
-    void display_decimal(uint8_t number, int8_t decimal_point = -1) {
-        clear_digits();
+    bool pop(avr_pin_change_event& event) {
+        return _events.pop(event);
+    }
+
+    /**
+     * Determines whether any captured events are waiting, see
+     * avr_isr_queue::empty().
+     *
+     * @returns True if there are no events.
+     */
+    bool empty() const {
+        return _events.empty();
+    }
+
+private:
+    /**
+     * Events captured by the interrupt handler and not yet taken.
+     */
+    avr_isr_queue<avr_pin_change_event, capacity_t> _events;
+};
+
+/**
+ * Debounces every button in one I/O bank using timestamped readings, such as
+ * the events from an avr_pin_change_capture. The first change of a pin is
+ * accepted immediately, so a press is reported as soon as its first edge is
+ * seen, and the pin is then locked out for a fixed time so that the bounces
+ * that follow are ignored. Readings should also be fed periodically, e.g. from
+ * a timer tick, so that a pin that settled in a different state than the one
+ * accepted while it was locked out is corrected once the lockout ends.
+ *
+ * Pins with their pull-up enabled are treated as active low, i.e. a low reading
+ * means the button is pressed.
+ *
+ * All times are in the units of the timestamps. Fed with the low 16 bits of an
+ * avr_millis_clock, the lockout is in milliseconds and does not depend on how
+ * often the main loop runs. Durations of up to 65535 units can be measured.
+ *
+ * @tparam lockout_t The lockout time, in timestamp units.
+ * @tparam pins_t    The avr_digital_input_pin types of the buttons, which must
+ *                   all be in the same bank.
+ */
+template <uint16_t lockout_t, typename ...pins_t>
+struct avr_edge_debouncer {
+    /**
+     * The combined properties of the debounced pins.
+     */
+    using pins = avr_digital_input_pin_set<pins_t...>;
+
+    /**
+     * Updates the debounced state of every pin from a reading of the bank's
+     * input register.
+     *
+     * @param reading   The value of the bank's input register.
+     * @param timestamp When the reading was taken. Readings must be fed in
+     *                  time order.
+     *
+     * @returns A mask of the pins whose debounced state changed.
+     */
+    uint8_t update(uint8_t reading, uint16_t timestamp) {
+        /**
+         * Release the pins whose lockout has ended.
+         */
+        if (_locked) {
+            for (uint8_t i = 0; i < 8; ++i) {
+                uint8_t mask = 1 << i;
+                if ((_locked & mask) &&
+                    static_cast<uint16_t>(timestamp - _changed_at[i])
+                    >= lockout_t) {
+                    _locked &= ~mask;
+                }
+            }
+        }
+
+        uint8_t changed = (((reading ^ pins::ACTIVE_LOW) & pins::MASK) ^ _state)
+                          & ~_locked;
+        if (changed) {
+            for (uint8_t i = 0; i < 8; ++i) {
+                if (changed & (1 << i)) {
+                    _durations[i] = timestamp - _changed_at[i];
+                    _changed_at[i] = timestamp;
+                }
+            }
+            _locked |= changed;
+        }
+
+        _state ^= changed;
+        _pressed = _state & changed;
+        _released = ~_state & changed;
+        return changed;
+    }
+
+    /**
+     * Gets the debounced state of every pin.
+     *
+     * @returns A mask with a bit set for every button that is pressed.
+     */
+    uint8_t state() const {
+        return _state;
+    }
+
+    /**
+     * Gets the buttons that were pressed by the last call to update().
+     *
+     * @returns A mask with a bit set for every button that changed to pressed.
+     */
+    uint8_t pressed() const {
+        return _pressed;
+    }
+
+    /**
+     * Gets the buttons that were released by the last call to update().
+     *
+     * @returns A mask with a bit set for every button that changed to released.
+     */
+    uint8_t released() const {
+        return _released;
+    }
+
+    /**
+     * Determines whether a particular button changed state in the last call to
+     * update().
+     *
+     * @tparam pin_t The avr_digital_input_pin of the button.
+     *
+     * @returns action::none if the button's state has not changed,
+     *          action::pressed if the button has just changed to pressed,
+     *          action::released if the button has just changed to released.
+     */
+    template <typename pin_t>
+    avr_button_action check() const {
+        static_assert((pins::MASK & pin_t::MASK) != 0,
+                      "The pin is not handled by this debouncer.");
+        if (_pressed & pin_t::MASK) {
+            return avr_button_action::pressed;
+        } else if (_released & pin_t::MASK) {
+            return avr_button_action::released;
+        }
+        return avr_button_action::none;
+    }
+
+    /**
+     * Gets how long a button stayed in its previous state before its last
+     * change. Right after a release this is how long the button was held.
+     *
+     * @tparam pin_t The avr_digital_input_pin of the button.
+     *
+     * @returns The duration, in timestamp units.
+     */
+    template <typename pin_t>
+    uint16_t duration() const {
+        static_assert((pins::MASK & pin_t::MASK) != 0,
+                      "The pin is not handled by this debouncer.");
+        return _durations[pin_t::BIT];
+    }
+
+    /**
+     * Gets how long a button has been held so far.
+     *
+     * @tparam pin_t The avr_digital_input_pin of the button.
+     *
+     * @param now The current time.
+     *
+     * @returns The time since the button was pressed, in timestamp units, or
+     *          0 if it is released.
+     */
+    template <typename pin_t>
+    uint16_t held_for(uint16_t now) const {
+        static_assert((pins::MASK & pin_t::MASK) != 0,
+                      "The pin is not handled by this debouncer.");
+        return (_state & pin_t::MASK) ? now - _changed_at[pin_t::BIT] : 0;
+    }
+
+private:
+    /**
+     * The debounced state, a set bit means the button is pressed.
+     */
+    uint8_t _state = 0;
+
+    /**
+     * The pins that are locked out.
+     */
+    uint8_t _locked = 0;
+
+    /**
+     * The pins that changed to pressed in the last update.
+     */
+    uint8_t _pressed = 0;
+
+    /**
+     * The pins that changed to released in the last update.
+     */
+    uint8_t _released = 0;
+
+    /**
+     * When each pin's debounced state last changed.
+     */
+    uint16_t _changed_at[8] = {};
+
+    /**
+     * How long each pin was in its previous state before its last change.
+     */
+    uint16_t _durations[8] = {};
+};
+
+/**
+ * Recognizes taps, double taps, long presses and chords of a set of buttons in
+ * one I/O bank from their debounced state, e.g. from an avr_edge_debouncer.
+ * The gestures are made by the combination of buttons held together, so a
+ * chord is just a gesture with more than one bit set:
+ *
+ *     Tap:        a combination is pressed and released before it becomes a
+ *                 long press. Reported on release, with every button that was
+ *                 held at some point.
+ *     Double tap: a tap of the same combination pressed within the double tap
+ *                 time of the previous tap's press. Reported on release, in
+ *                 place of the second tap.
+ *     Long press: the same combination is held for the long press time.
+ *                 Reported once, while still held, and no tap follows.
+ *
+ * Nothing here delays the debouncer's own pressed() report, so a button can
+ * act immediately on press and also take part in gestures; an application
+ * that does this should make sure its gestures undo or override the effect of
+ * the presses they are made of.
+ *
+ * Each update takes constant time and the state is a few bytes.
+ *
+ * @tparam long_press_t The time a combination must be held to be a long press,
+ *                      in timestamp units.
+ * @tparam double_tap_t The most time between the presses of a double tap, in
+ *                      timestamp units.
+ * @tparam pins_t       The avr_digital_input_pin types of the buttons, which
+ *                      must all be in the same bank.
+ */
+template <uint16_t long_press_t, uint16_t double_tap_t, typename ...pins_t>
+struct avr_gesture_detector {
+    /**
+     * The combined properties of the buttons.
+     */
+    using pins = avr_digital_input_pin_set<pins_t...>;
+
+    /**
+     * Updates the gestures from the debounced state of the bank. Must be called
+     * after every debouncer update, including periodic ones, so that long
+     * presses are seen while the buttons are still held.
+     *
+     * @param state     A mask with a bit set for every button that is pressed.
+     *                  Bits for other pins are ignored.
+     * @param timestamp The time of the state. Updates must be in time order.
+     */
+    void update(uint8_t state, uint16_t timestamp) {
+        state &= pins::MASK;
+        _tap = 0;
+        _double_tap = 0;
+        _long_press = 0;
+
+        /**
+         * Forget a tap once the next one is too late to make a double tap, so
+         * a stale timestamp can never wrap into range.
+         */
+        uint16_t next_press = _held ? _pressed_at : timestamp;
+        if (_last_tap &&
+            static_cast<uint16_t>(next_press - _last_tap_at) > double_tap_t) {
+            _last_tap = 0;
+        }
+
+        if (state != _held) {
+            if (!_held) {
+                _combination = 0;
+                _pressed_at = timestamp;
+                _reported = false;
+            }
+            _held = state;
+            _held_since = timestamp;
+            _combination |= state;
+
+            if (!state && !_reported) {
+                if (_combination == _last_tap &&
+                    static_cast<uint16_t>(_pressed_at - _last_tap_at)
+                    <= double_tap_t) {
+                    _double_tap = _combination;
+                    _last_tap = 0;
+                } else {
+                    _tap = _combination;
+                    _last_tap = _combination;
+                    _last_tap_at = _pressed_at;
+                }
+            }
+        } else if (state && !_reported &&
+                   static_cast<uint16_t>(timestamp - _held_since)
+                   >= long_press_t) {
+            _long_press = state;
+            _reported = true;
+        }
+    }
+
+    /**
+     * Ignores the buttons held now until they are all released, so they make
+     * no gesture.
+     */
+    void cancel() {
+        _reported = _held != 0;
+        _last_tap = 0;
+    }
+
+    /**
+     * Gets the buttons that made a tap in the last update.
+     *
+     * @returns A mask of the buttons, 0 if there was no tap.
+     */
+    uint8_t tap() const {
+        return _tap;
+    }
+
+    /**
+     * Gets the buttons that made a double tap in the last update.
+     *
+     * @returns A mask of the buttons, 0 if there was no double tap.
+     */
+    uint8_t double_tap() const {
+        return _double_tap;
+    }
+
+    /**
+     * Gets the buttons that made a long press in the last update.
+     *
+     * @returns A mask of the buttons, 0 if there was no long press.
+     */
+    uint8_t long_press() const {
+        return _long_press;
+    }
+
+private:
+    /**
+     * The buttons held as of the last update.
+     */
+    uint8_t _held = 0;
+
+    /**
+     * Every button held since the buttons were last all released.
+     */
+    uint8_t _combination = 0;
+
+    /**
+     * Set once the current hold has made a long press or was cancelled.
+     */
+    bool _reported = false;
+
+    /**
+     * The gestures made in the last update.
+     */
+    uint8_t _tap = 0;
+    uint8_t _double_tap = 0;
+    uint8_t _long_press = 0;
+
+    /**
+     * The last tap that could still become the first half of a double tap,
+     * or 0.
+     */
+    uint8_t _last_tap = 0;
+
+    /**
+     * When the first button of the current hold was pressed.
+     */
+    uint16_t _pressed_at = 0;
+
+    /**
+     * When the held buttons last changed.
+     */
+    uint16_t _held_since = 0;
+
+    /**
+     * When the first button of _last_tap was pressed.
+     */
+    uint16_t _last_tap_at = 0;
+};
+
+/**
+ * Bitmasks for each individual segment of seven segment displays.
+ *
+ *   AA
+ *  F  B
+ *  F  B
+ *   GG
+ *  E  C
+ *  E  C
+ *   DD  DP
+ */
+static constexpr uint8_t SEG_A  = 0b00000001;
+static constexpr uint8_t SEG_B  = 0b00000010;
+static constexpr uint8_t SEG_C  = 0b00000100;
+static constexpr uint8_t SEG_D  = 0b00001000;
+static constexpr uint8_t SEG_E  = 0b00010000;
+static constexpr uint8_t SEG_F  = 0b00100000;
+static constexpr uint8_t SEG_G  = 0b01000000;
+static constexpr uint8_t SEG_DP = 0b10000000;
+
+/**
+ * Seven segment patterns for decimal and hexadecimal numbers. Stored in program
+ * memory, use avr_seven_segment_digit() to read a pattern.
+ */
+static const uint8_t SEVSEG[16] PROGMEM = {
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F        , /* 0 */
+            SEG_B | SEG_C                                , /* 1 */
+    SEG_A | SEG_B |         SEG_D | SEG_E |         SEG_G, /* 2 */
+    SEG_A | SEG_B | SEG_C | SEG_D |                 SEG_G, /* 3 */
+            SEG_B | SEG_C |                 SEG_F | SEG_G, /* 4 */
+    SEG_A |         SEG_C | SEG_D |         SEG_F | SEG_G, /* 5 */
+                    SEG_C | SEG_D | SEG_E | SEG_F | SEG_G, /* 6 */
+    SEG_A | SEG_B | SEG_C                                , /* 7 */
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G, /* 8 */
+    SEG_A | SEG_B | SEG_C |                 SEG_F | SEG_G, /* 9 */
+    SEG_A | SEG_B | SEG_C |         SEG_E | SEG_F | SEG_G, /* A */
+                    SEG_C | SEG_D | SEG_E | SEG_F | SEG_G, /* b */
+    SEG_A |                 SEG_D | SEG_E | SEG_F        , /* C */
+            SEG_B | SEG_C | SEG_D | SEG_E |         SEG_G, /* d */
+    SEG_A |                 SEG_D | SEG_E | SEG_F | SEG_G, /* E */
+    SEG_A |                         SEG_E | SEG_F | SEG_G, /* F */
+};
+
+/**
+ * Gets the seven segment pattern for a decimal or hexadecimal digit.
+ *
+ * @param value The digit, only the low four bits are used.
+ *
+ * @returns The pattern for the digit.
+ */
+inline uint8_t avr_seven_segment_digit(uint8_t value) {
+    return pgm_read_byte(&SEVSEG[value & 0x0F]);
+}
+
+/**
+ * Packed BCD for 0 through 99, tens digit in the high nibble and ones digit in
+ * the low nibble. The AVR has no divide instruction, so splitting a score into
+ * digits with a lookup is much cheaper than calling the library's division.
+ * Stored in program memory, use avr_decimal_bcd() to read an entry.
+ */
+static const uint8_t DECIMAL_BCD[100] PROGMEM = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+    0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99,
+};
+
+/**
+ * Converts a number from 0 to 99 to packed BCD.
+ *
+ * @param number The number to convert, must be less than 100.
+ *
+ * @returns The tens digit in the high nibble and the ones digit in the low
+ *          nibble.
+ */
+inline uint8_t avr_decimal_bcd(uint8_t number) {
+    return pgm_read_byte(&DECIMAL_BCD[number]);
+}
+
+/**
+ * Divides a number by ten with a multiply and shift, which the AVR does in a
+ * few cycles with its hardware multiplier. (n * 205) >> 11 equals n / 10 for
+ * every n below 1029, so it is exact for any uint8_t.
+ *
+ * @param number The number to divide, replaced by the quotient.
+ *
+ * @returns The remainder.
+ */
+inline uint8_t avr_divmod10(uint8_t& number) {
+    uint8_t quotient = (static_cast<uint16_t>(number) * 205) >> 11;
+    uint8_t remainder = number - quotient * 10;
+    number = quotient;
+    return remainder;
+}
+
+/**
+ * Seven segment patterns for the ASCII characters from ' ' to DEL. Characters
+ * that can't be drawn with seven segments are blank. Stored in
+ * program memory, see SEVSEG_ASCII_FONT.
+ */
+static const uint8_t SEVSEG_ASCII[96] PROGMEM = {
+    0                                                             , /*   */
+            SEG_B |                                         SEG_DP, /* ! */
+            SEG_B |                         SEG_F                 , /* " */
+    0                                                             , /* # */
+    SEG_A |         SEG_C | SEG_D |         SEG_F | SEG_G         , /* $ */
+    0                                                             , /* % */
+    0                                                             , /* & */
+                                            SEG_F                 , /* ' */
+    SEG_A |                 SEG_D | SEG_E | SEG_F                 , /* ( */
+    SEG_A | SEG_B | SEG_C | SEG_D                                 , /* ) */
+    0                                                             , /* * */
+    0                                                             , /* + */
+                                    SEG_E                         , /* , */
+                                                    SEG_G         , /* - */
+                                                            SEG_DP, /* . */
+            SEG_B |                 SEG_E |         SEG_G         , /* / */
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F                 , /* 0 */
+            SEG_B | SEG_C                                         , /* 1 */
+    SEG_A | SEG_B |         SEG_D | SEG_E |         SEG_G         , /* 2 */
+    SEG_A | SEG_B | SEG_C | SEG_D |                 SEG_G         , /* 3 */
+            SEG_B | SEG_C |                 SEG_F | SEG_G         , /* 4 */
+    SEG_A |         SEG_C | SEG_D |         SEG_F | SEG_G         , /* 5 */
+                    SEG_C | SEG_D | SEG_E | SEG_F | SEG_G         , /* 6 */
+    SEG_A | SEG_B | SEG_C                                         , /* 7 */
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G         , /* 8 */
+    SEG_A | SEG_B | SEG_C |                 SEG_F | SEG_G         , /* 9 */
+    0                                                             , /* : */
+    0                                                             , /* ; */
+    0                                                             , /* < */
+                            SEG_D |                 SEG_G         , /* = */
+    0                                                             , /* > */
+    SEG_A | SEG_B |                 SEG_E |         SEG_G         , /* ? */
+    0                                                             , /* @ */
+    SEG_A | SEG_B | SEG_C |         SEG_E | SEG_F | SEG_G         , /* A */
+                    SEG_C | SEG_D | SEG_E | SEG_F | SEG_G         , /* B */
+    SEG_A |                 SEG_D | SEG_E | SEG_F                 , /* C */
+            SEG_B | SEG_C | SEG_D | SEG_E |         SEG_G         , /* D */
+    SEG_A |                 SEG_D | SEG_E | SEG_F | SEG_G         , /* E */
+    SEG_A |                         SEG_E | SEG_F | SEG_G         , /* F */
+    SEG_A |         SEG_C | SEG_D | SEG_E | SEG_F                 , /* G */
+            SEG_B | SEG_C |         SEG_E | SEG_F | SEG_G         , /* H */
+                                    SEG_E | SEG_F                 , /* I */
+            SEG_B | SEG_C | SEG_D | SEG_E                         , /* J */
+    SEG_A |         SEG_C |         SEG_E | SEG_F | SEG_G         , /* K */
+                            SEG_D | SEG_E | SEG_F                 , /* L */
+    SEG_A |         SEG_C |         SEG_E                         , /* M */
+                    SEG_C |         SEG_E |         SEG_G         , /* N */
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F                 , /* O */
+    SEG_A | SEG_B |                 SEG_E | SEG_F | SEG_G         , /* P */
+    SEG_A | SEG_B | SEG_C |                 SEG_F | SEG_G         , /* Q */
+                                    SEG_E |         SEG_G         , /* R */
+    SEG_A |         SEG_C | SEG_D |         SEG_F | SEG_G         , /* S */
+                            SEG_D | SEG_E | SEG_F | SEG_G         , /* T */
+            SEG_B | SEG_C | SEG_D | SEG_E | SEG_F                 , /* U */
+                    SEG_C | SEG_D | SEG_E                         , /* V */
+            SEG_B |         SEG_D |         SEG_F                 , /* W */
+            SEG_B | SEG_C |         SEG_E | SEG_F | SEG_G         , /* X */
+            SEG_B | SEG_C | SEG_D |         SEG_F | SEG_G         , /* Y */
+    SEG_A | SEG_B |         SEG_D | SEG_E |         SEG_G         , /* Z */
+    SEG_A |                 SEG_D | SEG_E | SEG_F                 , /* [ */
+                    SEG_C |                 SEG_F | SEG_G         , /* \ */
+    SEG_A | SEG_B | SEG_C | SEG_D                                 , /* ] */
+    SEG_A | SEG_B |                         SEG_F                 , /* ^ */
+                            SEG_D                                 , /* _ */
+            SEG_B                                                 , /* ` */
+    SEG_A | SEG_B | SEG_C | SEG_D | SEG_E |         SEG_G         , /* a */
+                    SEG_C | SEG_D | SEG_E | SEG_F | SEG_G         , /* b */
+                            SEG_D | SEG_E |         SEG_G         , /* c */
+            SEG_B | SEG_C | SEG_D | SEG_E |         SEG_G         , /* d */
+    SEG_A | SEG_B |         SEG_D | SEG_E | SEG_F | SEG_G         , /* e */
+    SEG_A |                         SEG_E | SEG_F | SEG_G         , /* f */
+    SEG_A | SEG_B | SEG_C | SEG_D |         SEG_F | SEG_G         , /* g */
+                    SEG_C |         SEG_E | SEG_F | SEG_G         , /* h */
+                    SEG_C                                         , /* i */
+            SEG_B | SEG_C | SEG_D                                 , /* j */
+    SEG_A |         SEG_C |         SEG_E | SEG_F | SEG_G         , /* k */
+                                    SEG_E | SEG_F                 , /* l */
+    SEG_A |         SEG_C |         SEG_E                         , /* m */
+                    SEG_C |         SEG_E |         SEG_G         , /* n */
+                    SEG_C | SEG_D | SEG_E |         SEG_G         , /* o */
+    SEG_A | SEG_B |                 SEG_E | SEG_F | SEG_G         , /* p */
+    SEG_A | SEG_B | SEG_C |                 SEG_F | SEG_G         , /* q */
+                                    SEG_E |         SEG_G         , /* r */
+    SEG_A |         SEG_C | SEG_D |         SEG_F | SEG_G         , /* s */
+                            SEG_D | SEG_E | SEG_F | SEG_G         , /* t */
+                    SEG_C | SEG_D | SEG_E                         , /* u */
+                    SEG_C | SEG_D | SEG_E                         , /* v */
+            SEG_B |         SEG_D |         SEG_F                 , /* w */
+            SEG_B | SEG_C |         SEG_E | SEG_F | SEG_G         , /* x */
+            SEG_B | SEG_C | SEG_D |         SEG_F | SEG_G         , /* y */
+    SEG_A | SEG_B |         SEG_D | SEG_E |         SEG_G         , /* z */
+    0                                                             , /* { */
+                                    SEG_E | SEG_F                 , /* | */
+    0                                                             , /* } */
+    SEG_A                                                         , /* ~ */
+    0                                                             , /* DEL */
+};
+
+/**
+ * A seven segment font, i.e. a table of patterns in program memory for a
+ * contiguous range of character codes. Fonts for other symbols can be added by
+ * defining another PROGMEM table and a font describing it, so the glyphs cost
+ * flash but no SRAM.
+ */
+struct avr_seven_segment_font {
+    /**
+     * The patterns, in program memory.
+     */
+    const uint8_t* glyphs;
+
+    /**
+     * The character code of the first pattern.
+     */
+    uint8_t first;
+
+    /**
+     * The number of patterns.
+     */
+    uint8_t count;
+
+    /**
+     * Gets the pattern for a character.
+     *
+     * @param c The character code.
+     *
+     * @returns The pattern, or 0 (blank) if the font has no pattern for it.
+     */
+    uint8_t glyph(uint8_t c) const {
+        c -= first;
+        return c < count ? pgm_read_byte(&glyphs[c]) : 0;
+    }
+};
+
+/**
+ * A font for the ASCII characters from ' ' to DEL.
+ */
+static constexpr avr_seven_segment_font SEVSEG_ASCII_FONT { SEVSEG_ASCII,
+                                                            ' ',
+                                                            96 };
+
+/**
+ * Abstraction over the display pins for a seven segment display. This class is
+ * not responsible for digit selection, just the segments. This allows multiple
+ * seven segment digits to use the same pin set with time mulitplexing.
+ *
+ * When every segment pin that is not null lives in the same bank as segment A,
+ * and segments A through DP occupy consecutive bits starting at segment A's
+ * bit, a whole pattern is written with a single masked store to the port
+ * register instead of one read-modify-write per segment. That store is not
+ * atomic with respect to other writers of the same port register, so other
+ * output pins in that bank should not be changed from a different interrupt
+ * context while the display is being driven. Any other wiring falls back to
+ * setting the pins one at a time.
+ *
+ * @tparam seg_a_t  The output pin to use for the A segment.
+ * @tparam seg_b_t  The output pin to use for the B segment.
+ * @tparam seg_c_t  The output pin to use for the C segment.
+ * @tparam seg_d_t  The output pin to use for the D segment.
+ * @tparam seg_e_t  The output pin to use for the E segment.
+ * @tparam seg_f_t  The output pin to use for the F segment.
+ * @tparam seg_g_t  The output pin to use for the G segment.
+ * @tparam seg_dp_t The output pin to use for the decimal point segment.
+ */
+template <typename seg_a_t,
+          typename seg_b_t,
+          typename seg_c_t,
+          typename seg_d_t,
+          typename seg_e_t,
+          typename seg_f_t,
+          typename seg_g_t,
+          typename seg_dp_t>
+struct avr_seven_segment_pins {
+    /**
+     * Creates a seven segment display controller, initializing the segment
+     * pins as outputs.
+     */
+    avr_seven_segment_pins() {
+        avr_digital_output_pin_list<seg_a_t, seg_b_t, seg_c_t, seg_d_t,
+                                    seg_e_t, seg_f_t, seg_g_t,
+                                    seg_dp_t>::init();
+    }
+
+    /**
+     * Outputs a decimal number to the seven segment display pins.
+     *
+     * @param number The number to display.
+     */
+    void display_decimal(uint8_t number) {
+        display_custom(avr_seven_segment_digit(avr_divmod10(number)));
+    }
+
+    /**
+     * Outputs a hexadecimal number to the seven segment display pins.
+     *
+     * @param number The number to display.
+     */
+    void display_hex(uint8_t number) {
+        display_custom(avr_seven_segment_digit(number));
+    }
+
+    /**
+     * Sets or clears the output of the decimal point segment.
+     *
+     * @param display True to set the decimal point, false to clear it.
+     */
+    void display_decimal_point(bool display) {
+        if (display) {
+            display_custom(_current_display | SEG_DP);
+        } else {
+            display_custom(_current_display & ~SEG_DP);
+        }
+    }
+
+    /**
+     * Sets all segments to not display.
+     */
+    void clear() {
+        display_custom(0);
+    }
+
+    /**
+     * Displays a custom pattern on the seven segment display.
+     *
+     * @param mask The mask to output to the seven segment display. Use the
+     *             SEG_X constants to control what is displayed.
+     */
+    void display_custom(uint8_t mask) {
+        write(mask, avr_bool_constant<GROUPED>());
+        _current_display = mask;
+    }
+
+private:
+    /**
+     * Determines whether a segment pin fits the single store layout, i.e. it
+     * is null or it is in segment A's bank at segment A's bit plus the
+     * segment's index.
+     *
+     * @tparam pin_t     The segment pin.
+     * @tparam segment_t The index of the segment, 0 for A through 7 for DP.
+     */
+    template <typename pin_t, uint8_t segment_t>
+    static constexpr bool in_group() {
+        return pin_t::IS_NULL ||
+               (avr_is_same<typename pin_t::bank,
+                            typename seg_a_t::bank>::value &&
+                pin_t::BIT == seg_a_t::BIT + segment_t);
+    }
+
+    /**
+     * True if the pattern can be written with a single masked store.
+     */
+    static constexpr bool GROUPED = !seg_a_t::IS_NULL &&
+                                    in_group<seg_b_t, 1>() &&
+                                    in_group<seg_c_t, 2>() &&
+                                    in_group<seg_d_t, 3>() &&
+                                    in_group<seg_e_t, 4>() &&
+                                    in_group<seg_f_t, 5>() &&
+                                    in_group<seg_g_t, 6>() &&
+                                    in_group<seg_dp_t, 7>();
+
+    /**
+     * The segment bits, in pattern order, that are wired to real pins.
+     */
+    static constexpr uint8_t PATTERN_MASK =
+        (seg_a_t::IS_NULL  ? 0 : SEG_A) |
+        (seg_b_t::IS_NULL  ? 0 : SEG_B) |
+        (seg_c_t::IS_NULL  ? 0 : SEG_C) |
+        (seg_d_t::IS_NULL  ? 0 : SEG_D) |
+        (seg_e_t::IS_NULL  ? 0 : SEG_E) |
+        (seg_f_t::IS_NULL  ? 0 : SEG_F) |
+        (seg_g_t::IS_NULL  ? 0 : SEG_G) |
+        (seg_dp_t::IS_NULL ? 0 : SEG_DP);
+
+    /**
+     * Writes a pattern to the port register of segment A's bank in one store.
+     *
+     * @param mask The pattern to output.
+     */
+    static void write(uint8_t mask, avr_bool_constant<true>) {
+        constexpr uint8_t port_mask = PATTERN_MASK << seg_a_t::BIT;
+        volatile uint8_t& port = seg_a_t::bank::port();
+        port = (port & ~port_mask) | ((mask << seg_a_t::BIT) & port_mask);
+    }
+
+    /**
+     * Writes a pattern to each segment pin in turn.
+     *
+     * @param mask The pattern to output.
+     */
+    static void write(uint8_t mask, avr_bool_constant<false>) {
+        seg_a_t::set(mask & SEG_A);
+        seg_b_t::set(mask & SEG_B);
+        seg_c_t::set(mask & SEG_C);
+        seg_d_t::set(mask & SEG_D);
+        seg_e_t::set(mask & SEG_E);
+        seg_f_t::set(mask & SEG_F);
+        seg_g_t::set(mask & SEG_G);
+        seg_dp_t::set(mask & SEG_DP);
+    }
+
+    /**
+     * The mask that is currently being displayed.
+     */
+    uint8_t _current_display = 0;
+};
+
+/**
+ * Abstraction for a time multiplexed seven segment display with some number
+ * of digits and a colon segment. If the display has no colon segment then
+ * avr_digital_output_pin_null can be used.
+ *
+ * The display functions do not drive the pins directly, they only render the
+ * segment patterns into a small framebuffer. The digits are actually lit by an
+ * avr_seven_segment_scanner that the display is attached to, so rendering
+ * returns immediately and the refresh rate does not depend on what the main
+ * loop is doing.
+ *
+ * @tparam num_digits_t The number of digits in the display.
+ * @tparam colon_t      The output pin to use for the colon segment.
+ */
+template <uint8_t num_digits_t,
+          typename colon_t = avr_digital_output_pin_null>
+struct avr_seven_segment_display {
+    /**
+     * Creates a seven segment display, initializing the colon pin.
+     */
+    avr_seven_segment_display() {
+        colon_t::init();
+    }
+
+    /**
+     * Display a number in decimal. Does nothing if the display already shows
+     * the same number from the last call, so it is cheap to call every time
+     * around a loop.
+     *
+     * @param number        The number to display.
+     * @param decimal_point The digit on which the decimal point segment should
+     *                      be enabled. Use -1 to disable the decimal point.
+     */
+    void display_decimal(uint8_t number, int8_t decimal_point = -1) {
+        if (_decimal_cached && number == _decimal_number &&
+            decimal_point == _decimal_point) {
+            return;
+        }
+        _decimal_cached = true;
+        _decimal_number = number;
+        _decimal_point = decimal_point;
+
+        /**
+         * Split the number into digits without dividing: the hundreds are taken
+         * off by comparison and the rest is a table lookup.
+         */
+        uint8_t digits[3] = {};
+        uint8_t significant = number >= 100 ? 3 : number >= 10 ? 2 : 1;
+        if (number >= 200) {
+            digits[2] = 2;
+            number -= 200;
+        } else if (number >= 100) {
+            digits[2] = 1;
+            number -= 100;
+        }
+        uint8_t bcd = avr_decimal_bcd(number);
+        digits[0] = bcd & 0x0F;
+        digits[1] = bcd >> 4;
+
         for (uint8_t i = 0; i < num_digits_t; ++i) {
-            if (number) {
-                _seg.display_decimal(number % 10);
-                number /= 10;
+            uint8_t mask;
+            if (i < significant) {
+                mask = avr_seven_segment_digit(i < 3 ? digits[i] : 0);
             } else if (i == 0 || (decimal_point >= 0 && i <= decimal_point)) {
-		/**
+                /**
                  * Always display the first digit and digits up to the decimal
-		 * point.
+                 * point.
                  */
-                _seg.display_decimal(0);
+                mask = avr_seven_segment_digit(0);
             } else {
                 /**
                  * Don't display digits after the first digit if the number is
                  * zero.
                  */
-                _seg.clear();
+                mask = 0;
             }
 
             if (i == decimal_point) {
-                _seg.display_decimal_point(true);
+                mask |= SEG_DP;
             }
 
-            _digits[i]->set(true);
-            _delay_ms(DIGIT_DELAY_MS);
-            _digits[i]->set(false);
-            _seg.clear();
+            _frame[i] = mask;
         }
     }
 
@@ -509,33 +1605,69 @@ struct avr_seven_segment_display {
      *                      be enabled. Use -1 to disable the decimal point.
      */
     void display_hex(uint32_t number, int8_t decimal_point = -1) {
-        clear_digits();
+        _decimal_cached = false;
         for (uint8_t i = 0; i < num_digits_t; ++i) {
+            uint8_t mask;
             if (number) {
-                _seg.display_hex(number % 0x10);
-                number /= 0x10;
+                mask = avr_seven_segment_digit(number);
+                number >>= 4;
             } else if (i == 0 || (decimal_point >= 0 && i <= decimal_point)) {
-		/**
+                /**
                  * Always display the first digit and digits up to the decimal
-		 * point.
+                 * point.
                  */
-                _seg.display_hex(0);
+                mask = avr_seven_segment_digit(0);
             } else {
                 /**
                  * Don't display digits after the first digit if the number is
                  * zero.
                  */
-                _seg.clear();
+                mask = 0;
             }
 
             if (i == decimal_point) {
-                _seg.display_decimal_point(true);
+                mask |= SEG_DP;
+            }
+
+            _frame[i] = mask;
+        }
+    }
+
+    /**
+     * Display a string, left aligned. A '.' following a character lights the
+     * decimal point of that character's digit instead of taking a digit of its
+     * own. Characters that don't fit are dropped and unused digits are blank.
+     *
+     * @param text The string to display.
+     * @param font The font to draw the characters with.
+     */
+    void display_text(const char* text,
+                      const avr_seven_segment_font& font = SEVSEG_ASCII_FONT) {
+        _decimal_cached = false;
+        uint8_t i = num_digits_t;
+        while (i) {
+            char c = *text;
+            if (!c) {
+                break;
+            }
+
+            ++text;
+            if (c == '.' && i < num_digits_t && !(_frame[i] & SEG_DP)) {
+                _frame[i] |= SEG_DP;
+            } else {
+                _frame[--i] = font.glyph(c);
             }
+        }
+
+        /**
+         * A '.' right after the last digit that fits still belongs to it.
+         */
+        if (!i && *text == '.') {
+            _frame[0] |= SEG_DP;
+        }
 
-            _digits[i]->set(true);
-            _delay_ms(DIGIT_DELAY_MS);
-            _digits[i]->set(false);
-            _seg.clear();
+        while (i) {
+            _frame[--i] = 0;
         }
     }
 
@@ -545,7 +1677,7 @@ struct avr_seven_segment_display {
      * @param display True to display the colon, false to not display the colon.
      */
     void display_colon(bool display) {
-        _colon.set(display);
+        colon_t::set(display);
     }
 
     /**
@@ -555,42 +1687,410 @@ struct avr_seven_segment_display {
      * @param digit The digit on which the pattern should be displayed.
      */
     void display_custom(uint8_t mask, uint8_t digit) {
-        if (digit <= num_digits_t) {
-            clear_digits();
-            _seg.display_custom(mask);
-            _digits[digit]->set(true);
+        if (digit < num_digits_t) {
+            _decimal_cached = false;
+            _frame[digit] = mask;
         }
     }
 
 private:
     /**
-     * How long to display each digit for time multiplexing.
+     * The scanner reads the framebuffer.
+     */
+    template <typename seg_t, typename ...digits_t>
+    friend struct avr_seven_segment_scanner;
+
+    /**
+     * The segment pattern for each digit. Written by the display functions and
+     * read by the scanner, which may run in an interrupt.
+     */
+    volatile uint8_t _frame[num_digits_t] = {};
+
+    /**
+     * Set if the framebuffer holds what display_decimal() rendered for
+     * _decimal_number and _decimal_point.
+     */
+    bool _decimal_cached = false;
+
+    /**
+     * The arguments of the last display_decimal() call.
+     */
+    uint8_t _decimal_number = 0;
+    int8_t _decimal_point = -1;
+};
+
+/**
+ * Owns a set of seven segment pins and the digit selection pins of any number
+ * of displays sharing them, and lights every digit of every attached display in
+ * turn. Each call to refresh() lights exactly one digit, so when refresh() is
+ * called at a fixed rate every digit gets the same on-time and the whole panel
+ * refreshes at that rate divided by the total number of digits.
+ *
+ * Digits are assigned to the digit selection pins in the order the displays are
+ * attached, least significant digit of each display first.
+ *
+ * @tparam seg_t    The avr_seven_segment_pins shared by all displays.
+ * @tparam digits_t The output pins used to select each digit, in scan order.
+ */
+template <typename seg_t, typename ...digits_t>
+struct avr_seven_segment_scanner {
+    /**
+     * The digit selection pins.
+     */
+    using digit_pins = avr_digital_output_pin_list<digits_t...>;
+
+    /**
+     * Creates a scanner, initializing the digit selection pins with every digit
+     * turned off.
+     */
+    avr_seven_segment_scanner() {
+        digit_pins::init();
+        for (uint8_t i = 0; i < digit_pins::SIZE; ++i) {
+            digit_pins::set(i, false);
+        }
+    }
+
+    /**
+     * Assigns the next unused digit selection pins to the digits of a display.
+     * Displays should be attached before refresh() is first called.
+     *
+     * @param display The display to attach.
+     *
+     * @returns True if the display was attached, false if there are not enough
+     *          unused digit selection pins for all of its digits.
      */
-    static const int DIGIT_DELAY_MS = 3;
+    template <uint8_t num_digits_t, typename colon_t>
+    bool attach(avr_seven_segment_display<num_digits_t, colon_t>& display) {
+        if (_num_digits + num_digits_t > digit_pins::SIZE) {
+            return false;
+        }
+
+        for (uint8_t i = 0; i < num_digits_t; ++i) {
+            _frames[_num_digits++] = &display._frame[i];
+        }
+        return true;
+    }
 
     /**
-     * Clears all digit seletion pins.
+     * Turns off the digit lit by the previous call and lights the next digit
+     * in the scan order. This is meant to be called from a timer interrupt at
+     * a fixed rate.
      */
-    void clear_digits() {
-        for (int i = 0; i < num_digits_t; ++i) {
-            _digits[i]->set(false);
+    void refresh() {
+        if (_num_digits == 0) {
+            return;
+        }
+
+        digit_pins::set(_scan_digit, false);
+        if (++_scan_digit == _num_digits) {
+            _scan_digit = 0;
         }
+        _seg.display_custom(*_frames[_scan_digit]);
+        digit_pins::set(_scan_digit, true);
     }
 
+    /**
+     * Turns off the digit lit by the last call to refresh(), leaving the whole
+     * panel dark until refresh() is called again. Whatever calls refresh()
+     * should be stopped first. The framebuffers are untouched, so the panel
+     * shows the same thing when refreshing resumes.
+     */
+    void blank() {
+        digit_pins::set(_scan_digit, false);
+        _seg.clear();
+    }
+
+    /**
+     * Gets the number of digits that have been attached.
+     *
+     * @returns The number of digits lit in one full scan of the panel.
+     */
+    uint8_t num_digits() const {
+        return _num_digits;
+    }
+
+private:
     /**
      * The pins to use for the segments.
      */
-    avr_seven_segment_pins& _seg;
+    seg_t _seg;
+
+    /**
+     * The framebuffer entry for each digit in scan order.
+     */
+    const volatile uint8_t* _frames[sizeof...(digits_t)];
+
+    /**
+     * The number of digits that have been attached.
+     */
+    uint8_t _num_digits = 0;
+
+    /**
+     * The digit that was lit by the last call to refresh().
+     */
+    uint8_t _scan_digit = 0;
+};
+
+/**
+ * Runs Timer0 in clear-timer-on-compare mode so that the TIMER0_COMPA_vect
+ * interrupt fires at a fixed rate. The interrupt handler itself must be defined
+ * by the application, usually to call avr_seven_segment_scanner::refresh().
+ *
+ * @tparam frequency_t The interrupt rate in hertz.
+ */
+template <uint32_t frequency_t>
+struct avr_timer0_interrupt {
+    /**
+     * The timer runs from the system clock divided by 64.
+     */
+    static constexpr uint32_t PRESCALER = 64;
+
+    /**
+     * The compare value that produces the requested rate.
+     */
+    static constexpr uint32_t TOP = F_CPU / PRESCALER / frequency_t - 1;
+
+    static_assert(TOP > 0 && TOP <= 0xFF,
+                  "Timer0 cannot produce the requested interrupt rate.");
+
+    /**
+     * Configures and starts the timer and enables its compare match interrupt.
+     * Interrupts must still be enabled globally with sei().
+     */
+    static void start() {
+        TCCR0A = _BV(WGM01);
+        TCCR0B = _BV(CS01) | _BV(CS00);
+        OCR0A = TOP;
+        TCNT0 = 0;
+        TIMSK0 |= _BV(OCIE0A);
+    }
+
+    /**
+     * Stops the timer and disables its compare match interrupt. Call start()
+     * to run it again.
+     */
+    static void stop() {
+        TIMSK0 &= ~_BV(OCIE0A);
+        TCCR0B = 0;
+    }
+};
+
+/**
+ * A millisecond system clock. The application's timer interrupt handler must
+ * call tick() once every millisecond, e.g. every other interrupt of an
+ * avr_timer0_interrupt<2000>. The count wraps after about 49 days and does not
+ * advance while the timer is stopped, e.g. in power-down.
+ */
+struct avr_millis_clock {
+    /**
+     * Advances the clock by one millisecond. Meant to be called from the timer
+     * interrupt handler.
+     */
+    void tick() {
+        _ms = _ms + 1;
+    }
+
+    /**
+     * Gets the current time. The count is read with interrupts disabled since
+     * it takes several instructions to read and tick() may run in between.
+     *
+     * @returns The number of milliseconds since the clock was created.
+     */
+    uint32_t now() const {
+        uint32_t ms;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            ms = _ms;
+        }
+        return ms;
+    }
+
+private:
+    /**
+     * The number of ticks so far.
+     */
+    volatile uint32_t _ms = 0;
+};
+
+#ifdef UDR0
+/**
+ * Interrupt driven driver for USART0, in asynchronous 8N1 mode. Writes are
+ * queued and sent by the data register empty interrupt, and received bytes are
+ * queued by the receive complete interrupt, so neither reading nor writing
+ * ever waits for the line. The interrupt handlers must be defined by the
+ * application:
+ *
+ *     ISR(USART_UDRE_vect) { serial.transmit_next(); }
+ *     ISR(USART_RX_vect) { serial.receive(); }
+ *
+ * The second is only needed if the receiver is started. Each handler moves one
+ * byte, so it delays other interrupts by only a few microseconds.
+ *
+ * @tparam baud_t        The baud rate.
+ * @tparam tx_capacity_t The number of bytes that can be queued for sending, a
+ *                       power of two no larger than 128.
+ * @tparam rx_capacity_t The number of received bytes that can be queued, a
+ *                       power of two no larger than 128.
+ */
+template <uint32_t baud_t, uint8_t tx_capacity_t, uint8_t rx_capacity_t>
+struct avr_usart0 {
+    /**
+     * The baud rate register value. The port runs in double speed mode, which
+     * gets closer to the common baud rates from the common crystals.
+     */
+    static constexpr uint16_t UBRR = (F_CPU + 4 * baud_t) / (8 * baud_t) - 1;
+
+    static_assert(UBRR <= 0x0FFF,
+                  "USART0 cannot run that slowly from this clock.");
+    static_assert(F_CPU / (8 * (UBRR + 1)) * 100 >= baud_t * 98 &&
+                  F_CPU / (8 * (UBRR + 1)) * 100 <= baud_t * 102,
+                  "USART0 cannot get within 2% of the baud rate.");
+
+    /**
+     * Powers up and configures the port and enables the receive interrupt.
+     * Interrupts must still be enabled globally with sei().
+     */
+    void start() {
+        configure(_BV(RXCIE0) | _BV(RXEN0) | _BV(TXEN0));
+    }
+
+    /**
+     * Powers up and configures the port to send only. The receiver is left
+     * off, so the RXD pin (PD0) stays an ordinary I/O pin and the receive
+     * interrupt handler isn't needed.
+     */
+    void start_transmitter() {
+        configure(_BV(TXEN0));
+    }
+
+    /**
+     * Queues a byte for sending.
+     *
+     * @param byte The byte to send.
+     *
+     * @returns True if the byte was queued, false if the queue was full.
+     */
+    bool write(uint8_t byte) {
+        if (!_tx.push(byte)) {
+            return false;
+        }
+
+        /**
+         * The interrupt handler only ever clears this bit, and only when the
+         * queue is empty, so setting it here can't lose anything even though
+         * the read-modify-write isn't atomic.
+         */
+        UCSR0B |= _BV(UDRIE0);
+        return true;
+    }
+
+    /**
+     * Queues a block of bytes for sending, either all of them or none of them,
+     * so a message is never cut short.
+     *
+     * @param data The bytes to send.
+     * @param size The number of bytes.
+     *
+     * @returns True if the bytes were queued, false if there wasn't room.
+     */
+    bool write(const uint8_t* data, uint8_t size) {
+        if (tx_capacity_t - _tx.size() < size) {
+            return false;
+        }
+
+        for (uint8_t i = 0; i < size; ++i) {
+            _tx.push(data[i]);
+        }
+        UCSR0B |= _BV(UDRIE0);
+        return true;
+    }
+
+    /**
+     * Takes the oldest received byte.
+     *
+     * @param byte Set to the received byte.
+     *
+     * @returns True if a byte was taken, false if none are waiting.
+     */
+    bool read(uint8_t& byte) {
+        return _rx.pop(byte);
+    }
+
+    /**
+     * Determines whether every queued byte has been handed to the port. The
+     * last byte may still be shifting out.
+     *
+     * @returns True if nothing is left to send.
+     */
+    bool idle() const {
+        return _tx.empty();
+    }
+
+    /**
+     * Gets the number of received bytes dropped, because they arrived garbled
+     * or the receive queue was full.
+     *
+     * @returns The number of dropped bytes, modulo 256.
+     */
+    uint8_t dropped() const {
+        return _dropped;
+    }
+
+    /**
+     * Hands the next queued byte to the port, or disables the data register
+     * empty interrupt if there are none. Must be called from the
+     * USART_UDRE_vect interrupt handler.
+     */
+    void transmit_next() {
+        uint8_t byte;
+        if (_tx.pop(byte)) {
+            UDR0 = byte;
+        } else {
+            UCSR0B &= ~_BV(UDRIE0);
+        }
+    }
+
+    /**
+     * Queues the byte that was just received. Must be called from the
+     * USART_RX_vect interrupt handler.
+     */
+    void receive() {
+        uint8_t status = UCSR0A;
+        uint8_t byte = UDR0;
+        if ((status & (_BV(FE0) | _BV(DOR0) | _BV(UPE0))) || !_rx.push(byte)) {
+            _dropped = _dropped + 1;
+        }
+    }
+
+private:
+    /**
+     * Powers up the port and sets the baud rate and frame format.
+     *
+     * @param control The value for UCSR0B, which enables the transmitter,
+     *                the receiver and their interrupts.
+     */
+    void configure(uint8_t control) {
+        PRR &= ~_BV(PRUSART0);
+        UBRR0 = UBRR;
+        UCSR0A = _BV(U2X0);
+        UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+        UCSR0B = control;
+    }
+
+    /**
+     * Bytes waiting to be sent.
+     */
+    avr_isr_queue<uint8_t, tx_capacity_t> _tx;
 
     /**
-     * The pin to use to display the colon.
+     * Bytes received and not yet read.
      */
-    const avr_digital_output_pin_interface& _colon;
+    avr_isr_queue<uint8_t, rx_capacity_t> _rx;
 
     /**
-     * The pins to use to select digits.
+     * The number of received bytes dropped.
      */
-    const avr_digital_output_pin_interface* _digits[num_digits_t];
+    volatile uint8_t _dropped = 0;
 };
+#endif
 
 #endif /* __AVR_IO_HPP__ */
@@ -0,0 +1,168 @@
+/**
+ * A lock-free single producer, single consumer ring buffer for handing data
+ * between interrupt handlers and the main loop.
+ *
+ * This has no AVR-specific dependencies, so it also builds on the development
+ * machine, where the producer and consumer may be real threads.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#ifndef __AVR_ISR_QUEUE_HPP__
+#define __AVR_ISR_QUEUE_HPP__
+
+#include <stdint.h>
+
+/**
+ * A fixed capacity queue for handing items from exactly one interrupt handler
+ * to the main loop, or the other way around. The producer only ever writes the
+ * head index and the consumer only ever writes the tail index, and both are
+ * single bytes, which the AVR loads and stores in one instruction, so neither
+ * side ever needs to disable interrupts.
+ *
+ * The indices count every item ever pushed or popped, modulo 256, and the
+ * capacity is a power of two, so an index is turned into a slot with a mask
+ * and the number of queued items is just their difference.
+ *
+ * @tparam item_t     The type of the queued items.
+ * @tparam capacity_t The maximum number of queued items, a power of two no
+ *                    larger than 128.
+ */
+template <typename item_t, uint8_t capacity_t>
+struct avr_isr_queue {
+    static_assert(capacity_t > 0 && capacity_t <= 128 &&
+                  (capacity_t & (capacity_t - 1)) == 0,
+                  "The capacity must be a power of two no larger than 128.");
+
+    /**
+     * The maximum number of queued items.
+     */
+    static constexpr uint8_t CAPACITY = capacity_t;
+
+    /**
+     * Adds an item to the queue. Must only be called by the producer.
+     *
+     * @param item The item to add.
+     *
+     * @returns True if the item was added, false if the queue was full.
+     */
+    bool push(const item_t& item) {
+        uint8_t head = _head;
+        if (static_cast<uint8_t>(head - load_acquire(_tail)) == capacity_t) {
+            return false;
+        }
+        _items[head & (capacity_t - 1)] = item;
+
+        /**
+         * Make sure the item is stored before the consumer can see it.
+         */
+        store_release(_head, head + 1);
+        return true;
+    }
+
+    /**
+     * Removes the oldest item from the queue. Must only be called by the
+     * consumer.
+     *
+     * @param item Set to the removed item.
+     *
+     * @returns True if an item was removed, false if the queue was empty.
+     */
+    bool pop(item_t& item) {
+        uint8_t tail = _tail;
+        if (tail == load_acquire(_head)) {
+            return false;
+        }
+        item = _items[tail & (capacity_t - 1)];
+
+        /**
+         * Make sure the item is loaded before the producer can overwrite it.
+         */
+        store_release(_tail, tail + 1);
+        return true;
+    }
+
+    /**
+     * Determines whether the queue is empty. Meant for the consumer, e.g. to
+     * decide whether to sleep, in which case interrupts should be disabled
+     * until the sleep so that an item pushed in between is not missed.
+     *
+     * @returns True if there are no items in the queue.
+     */
+    bool empty() const {
+        return load_acquire(_tail) == load_acquire(_head);
+    }
+
+    /**
+     * Determines whether the queue is full. Meant for the producer.
+     *
+     * @returns True if no more items can be pushed.
+     */
+    bool full() const {
+        return size() == capacity_t;
+    }
+
+    /**
+     * Gets the number of queued items. Either side may call this, but the
+     * other side may change it at any time.
+     *
+     * @returns The number of items in the queue.
+     */
+    uint8_t size() const {
+        return load_acquire(_head) - load_acquire(_tail);
+    }
+
+private:
+    /**
+     * Reads an index written by the other side. On the AVR a single byte load
+     * is atomic and there is only one core, so it only has to stay in program
+     * order. On the host the load must also synchronize with the other thread.
+     *
+     * @param index The index to read.
+     *
+     * @returns The value of the index.
+     */
+    static uint8_t load_acquire(const volatile uint8_t& index) {
+#ifdef __AVR__
+        uint8_t value = index;
+        __asm__ __volatile__ ("" ::: "memory");
+        return value;
+#else
+        return __atomic_load_n(&index, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    /**
+     * Writes an index read by the other side, after every earlier memory
+     * access has completed.
+     *
+     * @param index The index to write.
+     * @param value The new value of the index.
+     */
+    static void store_release(volatile uint8_t& index, uint8_t value) {
+#ifdef __AVR__
+        __asm__ __volatile__ ("" ::: "memory");
+        index = value;
+#else
+        __atomic_store_n(&index, value, __ATOMIC_RELEASE);
+#endif
+    }
+
+    /**
+     * The number of items ever pushed, modulo 256.
+     */
+    volatile uint8_t _head = 0;
+
+    /**
+     * The number of items ever popped, modulo 256.
+     */
+    volatile uint8_t _tail = 0;
+
+    /**
+     * Storage for the queued items.
+     */
+    item_t _items[capacity_t];
+};
+
+#endif /* __AVR_ISR_QUEUE_HPP__ */
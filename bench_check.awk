@@ -0,0 +1,137 @@
+#
+# Checks the results of the simavr benchmarks, see scornado_bench.cpp, as
+# written to bench_output.txt by make bench:
+#
+#     awk -f bench_check.awk bench_output.txt
+#
+# Every benchmark must be present. The cycle counts must be consistent, with
+# min <= avg <= max and no count past what count_cycles() can time, and the
+# number of runs must be the benchmark's own. The lines that depend only on
+# the clock and the baud rate must be in the ranges worked out below. The cycle
+# counts themselves depend on the compiler, so they are not checked. Problems
+# are written to stderr and the exit status is 1 if there are any.
+#
+# @author Aaron Jones <aaron@jonesinator.com>
+# @license GPLv3
+#
+
+#
+# Gets a numeric field of a line, or -1 if the line doesn't have it.
+#
+function field(line, name,    pattern) {
+    pattern = "\"" name "\":[0-9]+"
+    if (!match(line, pattern)) {
+        return -1
+    }
+    return substr(line, RSTART + length(name) + 3,
+                  RLENGTH - length(name) - 3) + 0
+}
+
+#
+# Requires a field of a benchmark's line to be from low to high.
+#
+function expect(name, key, low, high) {
+    ++ranges
+    range_name[ranges] = name
+    range_key[ranges] = key
+    range_low[ranges] = low
+    range_high[ranges] = high
+}
+
+#
+# Reports a problem.
+#
+function fail(message) {
+    print "bench_check: " message > "/dev/stderr"
+    ++failures
+}
+
+BEGIN {
+    #
+    # The cycle count benchmarks and their runs, 0 where the runs depend on
+    # the pseudo-random points.
+    #
+    runs["avr_button::check"] = 256
+    runs["avr_port_debouncer::sample"] = 256
+    runs["avr_edge_debouncer::update"] = 256
+    runs["avr_isr_queue::push"] = 256
+    runs["avr_isr_queue::pop"] = 256
+    runs["avr_seven_segment_display::display_decimal"] = 100
+    runs["avr_seven_segment_scanner::refresh"] = 100
+    runs["table_tennis::p1_score"] = 0
+    runs["table_tennis::p2_score"] = 0
+    runs["table_tennis::serve"] = 1024
+    runs["table_tennis::undo"] = 0
+    runs["main_loop"] = 256
+    runs["main_loop_idle"] = 256
+    runs["telemetry::send"] = 64
+    runs["telemetry::drain"] = 64
+
+    #
+    # The display timer ticks at exactly 2000Hz, every 8000 cycles, so 4000
+    # ticks take 32000000 cycles, less part of the first tick.
+    #
+    expect("duty_cycle", "ticks", 4000, 4000)
+    expect("duty_cycle", "cycles", 31900000, 32100000)
+    expect("duty_cycle", "permille", 0, 1000)
+
+    #
+    # At 38400 baud in double speed mode UBRR0 is 51, so a byte of ten bits
+    # takes 8 * 52 * 10 = 4160 cycles and a frame of twelve 49920, which is
+    # 320.5 frames per second. Draining a frame waits for the byte that was
+    # shifting out when it started and eleven more, 45760 to 49920 cycles,
+    # plus building and queueing it.
+    #
+    expect("telemetry::rate", "frames", 64, 64)
+    expect("telemetry::rate", "frames_per_s", 316, 325)
+    expect("telemetry::drain", "avg", 45000, 51000)
+}
+
+match($0, /^\{"bench":"[^"]*"/) {
+    name = substr($0, 11, RLENGTH - 11)
+    if (name in seen) {
+        fail(name " is reported twice")
+    }
+    seen[name] = 1
+
+    if (name in runs) {
+        n = field($0, "n")
+        min = field($0, "min")
+        avg = field($0, "avg")
+        max = field($0, "max")
+        if (n < 1 || (runs[name] && n != runs[name])) {
+            fail(name " ran " n " times")
+        }
+        if (min < 0 || min > avg || avg > max || max >= 131072) {
+            fail(name " has min " min ", avg " avg " and max " max)
+        }
+    }
+
+    for (i = 1; i <= ranges; ++i) {
+        if (range_name[i] != name) {
+            continue
+        }
+        value = field($0, range_key[i])
+        if (value < range_low[i] || value > range_high[i]) {
+            fail(name " " range_key[i] " is " value ", expected " \
+                 range_low[i] " to " range_high[i])
+        }
+    }
+}
+
+END {
+    for (name in runs) {
+        if (!(name in seen)) {
+            fail(name " is missing")
+        }
+    }
+    for (i = 1; i <= ranges; ++i) {
+        if (!(range_name[i] in seen) && !(range_name[i] in runs)) {
+            fail(range_name[i] " is missing")
+            seen[range_name[i]] = 1
+        }
+    }
+    if (failures) {
+        exit 1
+    }
+}
@@ -0,0 +1,18 @@
+/**
+ * Host stand-in for avr-libc's <avr/interrupt.h>, see avr_host.hpp. Interrupt
+ * handlers become ordinary functions that host code can call directly.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#ifndef __AVR_HOST_INTERRUPT_H__
+#define __AVR_HOST_INTERRUPT_H__
+
+#include "../avr_host.hpp"
+
+#define ISR(vector, ...) extern "C" void vector(void)
+#define sei() (avr_host_interrupts_enabled() = true)
+#define cli() (avr_host_interrupts_enabled() = false)
+
+#endif /* __AVR_HOST_INTERRUPT_H__ */
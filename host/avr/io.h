@@ -0,0 +1,140 @@
+/**
+ * Host stand-in for avr-libc's <avr/io.h>, see avr_host.hpp. Defines the
+ * atmega328p registers and bits used by this project as locations in the host
+ * register file.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#ifndef __AVR_HOST_IO_H__
+#define __AVR_HOST_IO_H__
+
+#include <stdint.h>
+
+#include "../avr_host.hpp"
+
+#define _BV(bit) (1 << (bit))
+#define _SFR_MEM8(addr) (avr_host_registers().bytes[addr])
+#define _SFR_MEM16(addr) \
+    (*reinterpret_cast<volatile uint16_t*>(&avr_host_registers().bytes[addr]))
+
+/**
+ * I/O banks.
+ */
+#define PINB   _SFR_MEM8(0x23)
+#define DDRB   _SFR_MEM8(0x24)
+#define PORTB  _SFR_MEM8(0x25)
+#define PINC   _SFR_MEM8(0x26)
+#define DDRC   _SFR_MEM8(0x27)
+#define PORTC  _SFR_MEM8(0x28)
+#define PIND   _SFR_MEM8(0x29)
+#define DDRD   _SFR_MEM8(0x2A)
+#define PORTD  _SFR_MEM8(0x2B)
+
+/**
+ * Interrupt flags and general purpose registers.
+ */
+#define TIFR0  _SFR_MEM8(0x35)
+#define TIFR1  _SFR_MEM8(0x36)
+#define PCIFR  _SFR_MEM8(0x3B)
+#define GPIOR0 _SFR_MEM8(0x3E)
+#define GPIOR1 _SFR_MEM8(0x4A)
+#define GPIOR2 _SFR_MEM8(0x4B)
+#define ACSR   _SFR_MEM8(0x50)
+#define SMCR   _SFR_MEM8(0x53)
+#define MCUCR  _SFR_MEM8(0x55)
+#define SREG   _SFR_MEM8(0x5F)
+
+/**
+ * Power reduction and pin change interrupts.
+ */
+#define PRR    _SFR_MEM8(0x64)
+#define PCICR  _SFR_MEM8(0x68)
+#define PCMSK0 _SFR_MEM8(0x6B)
+#define PCMSK1 _SFR_MEM8(0x6C)
+#define PCMSK2 _SFR_MEM8(0x6D)
+
+/**
+ * Timer0.
+ */
+#define TCCR0A _SFR_MEM8(0x44)
+#define TCCR0B _SFR_MEM8(0x45)
+#define TCNT0  _SFR_MEM8(0x46)
+#define OCR0A  _SFR_MEM8(0x47)
+#define OCR0B  _SFR_MEM8(0x48)
+#define TIMSK0 _SFR_MEM8(0x6E)
+
+/**
+ * Timer1.
+ */
+#define TIMSK1 _SFR_MEM8(0x6F)
+#define TCCR1A _SFR_MEM8(0x80)
+#define TCCR1B _SFR_MEM8(0x81)
+#define TCNT1  _SFR_MEM16(0x84)
+#define OCR1A  _SFR_MEM16(0x88)
+
+/**
+ * USART0.
+ */
+#define UCSR0A _SFR_MEM8(0xC0)
+#define UCSR0B _SFR_MEM8(0xC1)
+#define UCSR0C _SFR_MEM8(0xC2)
+#define UBRR0  _SFR_MEM16(0xC4)
+#define UDR0   _SFR_MEM8(0xC6)
+
+/**
+ * Register bits.
+ */
+#define TOV0    0
+#define OCF0A   1
+#define TOV1    0
+#define OCF1A   1
+#define WGM00   0
+#define WGM01   1
+#define CS00    0
+#define CS01    1
+#define CS02    2
+#define OCIE0A  1
+#define WGM10   0
+#define WGM11   1
+#define WGM12   3
+#define WGM13   4
+#define CS10    0
+#define CS11    1
+#define CS12    2
+#define OCIE1A  1
+#define PCIE0   0
+#define PCIE1   1
+#define PCIE2   2
+#define PCIF0   0
+#define PCIF1   1
+#define PCIF2   2
+#define PRADC   0
+#define PRUSART0 1
+#define PRSPI   2
+#define PRTIM1  3
+#define PRTIM0  5
+#define PRTIM2  6
+#define PRTWI   7
+#define ACD     7
+#define MPCM0   0
+#define U2X0    1
+#define UPE0    2
+#define DOR0    3
+#define FE0     4
+#define UDRE0   5
+#define TXC0    6
+#define RXC0    7
+#define TXB80   0
+#define RXB80   1
+#define UCSZ02  2
+#define TXEN0   3
+#define RXEN0   4
+#define UDRIE0  5
+#define TXCIE0  6
+#define RXCIE0  7
+#define UCSZ00  1
+#define UCSZ01  2
+
+#endif /* __AVR_HOST_IO_H__ */
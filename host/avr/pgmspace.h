@@ -0,0 +1,22 @@
+/**
+ * Host stand-in for avr-libc's <avr/pgmspace.h>, see avr_host.hpp. The host has
+ * a single address space, so program memory is ordinary constant data.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#ifndef __AVR_HOST_PGMSPACE_H__
+#define __AVR_HOST_PGMSPACE_H__
+
+#include <stdint.h>
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(str) (str)
+
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t*>(addr))
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t*>(addr))
+#define pgm_read_ptr(addr) (*reinterpret_cast<const void* const*>(addr))
+
+#endif /* __AVR_HOST_PGMSPACE_H__ */
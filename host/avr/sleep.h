@@ -0,0 +1,41 @@
+/**
+ * Host stand-in for avr-libc's <avr/sleep.h>, see avr_host.hpp. Sleeping does
+ * nothing since the host never raises interrupts to wake up from it.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#ifndef __AVR_HOST_SLEEP_H__
+#define __AVR_HOST_SLEEP_H__
+
+#include <avr/io.h>
+
+#define SLEEP_MODE_IDLE       0x00
+#define SLEEP_MODE_ADC        0x02
+#define SLEEP_MODE_PWR_DOWN   0x04
+#define SLEEP_MODE_PWR_SAVE   0x06
+#define SLEEP_MODE_STANDBY    0x0C
+
+inline void set_sleep_mode(uint8_t mode) {
+    SMCR = (SMCR & 0x01) | mode;
+}
+
+inline void sleep_enable() {
+    SMCR |= 0x01;
+}
+
+inline void sleep_disable() {
+    SMCR &= ~0x01;
+}
+
+inline void sleep_cpu() {
+}
+
+inline void sleep_mode() {
+}
+
+inline void sleep_bod_disable() {
+}
+
+#endif /* __AVR_HOST_SLEEP_H__ */
@@ -0,0 +1,109 @@
+/**
+ * Host backend for code written against avr-libc. The headers in this
+ * directory stand in for avr-libc's so that avr_io.hpp and everything built on
+ * it can be compiled and run on a desktop machine, e.g. to test or benchmark it
+ * at native speed.
+ *
+ * The I/O registers are plain memory, so writing PORTD simply stores a byte and
+ * reading PIND returns whatever was last stored there. Tests drive inputs by
+ * writing the PINx registers and check outputs by reading the PORTx registers.
+ * Time is a virtual cycle counter that only moves when _delay_ms/_delay_us or
+ * avr_host_advance() is called, which also advances the Timer0 and Timer1
+ * counters. Interrupts are never raised on their own, interrupt handlers are
+ * ordinary functions that the host code calls when it wants them to run.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#ifndef __AVR_HOST_HPP__
+#define __AVR_HOST_HPP__
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#error "F_CPU must be defined for the host backend."
+#endif
+
+/**
+ * The I/O register file, covering the same data space addresses as on the
+ * atmega328p.
+ */
+struct avr_host_register_file {
+    alignas(2) volatile uint8_t bytes[0x100];
+};
+
+/**
+ * Gets the I/O register file.
+ *
+ * @returns The one register file shared by all code in the program.
+ */
+inline avr_host_register_file& avr_host_registers() {
+    static avr_host_register_file registers;
+    return registers;
+}
+
+/**
+ * Gets the virtual clock.
+ *
+ * @returns The number of CPU cycles that have elapsed.
+ */
+inline uint64_t& avr_host_cycles() {
+    static uint64_t cycles = 0;
+    return cycles;
+}
+
+/**
+ * Gets the global interrupt enable flag, set by sei() and cleared by cli().
+ *
+ * @returns The interrupt enable flag.
+ */
+inline bool& avr_host_interrupts_enabled() {
+    static bool enabled = false;
+    return enabled;
+}
+
+/**
+ * Gets the divider a timer's clock select bits choose.
+ *
+ * @param clock_select The three clock select bits of the timer.
+ *
+ * @returns The divider, or 0 if the timer is stopped or externally clocked.
+ */
+inline uint16_t avr_host_prescaler(uint8_t clock_select) {
+    static const uint16_t prescalers[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+    return prescalers[clock_select & 0x07];
+}
+
+/**
+ * Advances the virtual clock, counting Timer0 and Timer1 up by the number of
+ * ticks that elapsed at their configured prescalers. Both timers wrap at their
+ * compare A value in CTC mode and at their maximum otherwise.
+ *
+ * @param cycles The number of CPU cycles to advance by.
+ */
+inline void avr_host_advance(uint64_t cycles) {
+    volatile uint8_t* r = avr_host_registers().bytes;
+    uint64_t before = avr_host_cycles();
+    uint64_t after = before + cycles;
+    avr_host_cycles() = after;
+
+    uint16_t prescaler0 = avr_host_prescaler(r[0x45]);
+    if (prescaler0) {
+        uint64_t ticks = after / prescaler0 - before / prescaler0;
+        uint32_t top = (r[0x44] & 0x02) ? r[0x47] + 1u : 0x100u;
+        r[0x46] = (r[0x46] + ticks) % top;
+    }
+
+    uint16_t prescaler1 = avr_host_prescaler(r[0x81]);
+    if (prescaler1) {
+        volatile uint16_t& tcnt1 = *reinterpret_cast<volatile uint16_t*>(
+                                   &r[0x84]);
+        uint16_t ocr1a = *reinterpret_cast<volatile uint16_t*>(&r[0x88]);
+        uint64_t ticks = after / prescaler1 - before / prescaler1;
+        uint32_t top = (r[0x81] & 0x08) ? ocr1a + 1u : 0x10000u;
+        tcnt1 = (tcnt1 + ticks) % top;
+    }
+}
+
+#endif /* __AVR_HOST_HPP__ */
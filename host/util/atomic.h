@@ -0,0 +1,22 @@
+/**
+ * Host stand-in for avr-libc's <util/atomic.h>, see avr_host.hpp. Since host
+ * interrupt handlers only run when called, the body of an atomic block only
+ * needs to run once.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#ifndef __AVR_HOST_ATOMIC_H__
+#define __AVR_HOST_ATOMIC_H__
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define NONATOMIC_RESTORESTATE
+#define NONATOMIC_FORCEOFF
+
+#define ATOMIC_BLOCK(type) for (bool __atomic_once = true; __atomic_once; \
+                                __atomic_once = false)
+#define NONATOMIC_BLOCK(type) ATOMIC_BLOCK(type)
+
+#endif /* __AVR_HOST_ATOMIC_H__ */
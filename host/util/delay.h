@@ -0,0 +1,22 @@
+/**
+ * Host stand-in for avr-libc's <util/delay.h>, see avr_host.hpp. Delays advance
+ * the virtual clock instead of spinning.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#ifndef __AVR_HOST_DELAY_H__
+#define __AVR_HOST_DELAY_H__
+
+#include "../avr_host.hpp"
+
+inline void _delay_ms(double ms) {
+    avr_host_advance(static_cast<uint64_t>(ms * (F_CPU / 1000.0)));
+}
+
+inline void _delay_us(double us) {
+    avr_host_advance(static_cast<uint64_t>(us * (F_CPU / 1000000.0)));
+}
+
+#endif /* __AVR_HOST_DELAY_H__ */
@@ -5,130 +5,486 @@
  * @license GPLv3
  */
 
+#include <avr/interrupt.h>
 #include <avr/io.h>
+#include <avr/sleep.h>
 
 #include "avr_io.hpp"
+#include "scornado_board.hpp"
+#include "scornado_telemetry.hpp"
 #include "table_tennis.hpp"
 
 /**
- * The atmega328p has three I/O banks and we use all of them.
+ * Assign high-level pin abstractions.
  */
-avr_io_bank avr_io_bank_b { &DDRB, &PORTB, &PINB };
-avr_io_bank avr_io_bank_c { &DDRC, &PORTC, &PINC };
-avr_io_bank avr_io_bank_d { &DDRD, &PORTD, &PIND };
+avr_pin_change_capture<
+    8,
+    game_mode_switch,
+    first_serve_switch,
+    p1_score_switch,
+    p2_score_switch> bank_c_capture;
+avr_pin_change_capture<8, undo_switch> bank_d_capture;
 
 /**
- * Assign low-level pin assignments.
+ * The system clock, ticked by the display timer. Button events are timestamped
+ * with its low 16 bits.
  */
-avr_digital_output_pin            sevseg_a(avr_io_bank_d, 0);       /* Pin 2  */
-avr_digital_output_pin            sevseg_b(avr_io_bank_d, 1);       /* Pin 3  */
-avr_digital_output_pin            sevseg_c(avr_io_bank_d, 2);       /* Pin 4  */
-avr_digital_output_pin            sevseg_d(avr_io_bank_d, 3);       /* Pin 5  */
-avr_digital_output_pin            sevseg_e(avr_io_bank_d, 4);       /* Pin 6  */
-avr_digital_output_pin            sevseg_f(avr_io_bank_d, 5);       /* Pin 11 */
-avr_digital_output_pin            sevseg_g(avr_io_bank_d, 6);       /* Pin 12 */
-avr_digital_input_pin          undo_switch(avr_io_bank_d, 7, true); /* Pin 13 */
-avr_digital_output_pin  p1_games_won_digit(avr_io_bank_b, 0);       /* Pin 14 */
-avr_digital_output_pin p1_score_ones_digit(avr_io_bank_b, 1);       /* Pin 15 */
-avr_digital_output_pin p1_score_tens_digit(avr_io_bank_b, 2);       /* Pin 16 */
-avr_digital_output_pin  p2_games_won_digit(avr_io_bank_b, 3);       /* Pin 17 */
-avr_digital_output_pin p2_score_ones_digit(avr_io_bank_b, 4);       /* Pin 18 */
-avr_digital_output_pin p2_score_tens_digit(avr_io_bank_b, 5);       /* Pin 19 */
-avr_digital_output_pin        p1_serve_led(avr_io_bank_c, 0);       /* Pin 23 */
-avr_digital_output_pin        p2_serve_led(avr_io_bank_c, 1);       /* Pin 24 */
-avr_digital_input_pin     game_mode_switch(avr_io_bank_c, 2, true); /* Pin 25 */
-avr_digital_input_pin   first_serve_switch(avr_io_bank_c, 3, true); /* Pin 26 */
-avr_digital_input_pin      p1_score_switch(avr_io_bank_c, 4, true); /* Pin 27 */
-avr_digital_input_pin      p2_score_switch(avr_io_bank_c, 5, true); /* Pin 28 */
+avr_millis_clock system_clock;
 
 /**
- * Assign high-level pin abstractions.
+ * Buttons are locked out for 20ms after each accepted change to ignore bounces.
  */
-avr_button undo_button(undo_switch);
-avr_button game_mode_button(game_mode_switch);
-avr_button first_serve_button(first_serve_switch);
-avr_button p1_score_button(p1_score_switch);
-avr_button p2_score_button(p2_score_switch);
-avr_seven_segment_pins seven_segment_pins(
-    sevseg_a,
-    sevseg_b,
-    sevseg_c,
-    sevseg_d,
-    sevseg_e,
-    sevseg_f,
-    sevseg_g,
-    avr_digital_output_pin_null::instance());
-avr_seven_segment_display<2> p1_score_display(
-    seven_segment_pins,
-    avr_digital_output_pin_null::instance(),
-    &p1_score_ones_digit,
-    &p1_score_tens_digit);
-avr_seven_segment_display<1> p1_games_won_display(
-    seven_segment_pins,
-    avr_digital_output_pin_null::instance(),
-    &p1_games_won_digit);
-avr_seven_segment_display<2> p2_score_display(
-    seven_segment_pins,
-    avr_digital_output_pin_null::instance(),
-    &p2_score_ones_digit,
-    &p2_score_tens_digit);
-avr_seven_segment_display<1> p2_games_won_display(
+static const uint16_t DEBOUNCE_MS = 20;
+avr_edge_debouncer<
+    DEBOUNCE_MS,
+    game_mode_switch,
+    first_serve_switch,
+    p1_score_switch,
+    p2_score_switch> bank_c_buttons;
+avr_edge_debouncer<DEBOUNCE_MS, undo_switch> bank_d_buttons;
+
+/**
+ * Gestures give the buttons more functions. Holding both scoring buttons for
+ * two seconds starts a new match. Tapping undo undoes a point and holding it
+ * for a second swaps ends. The scoring buttons still score on press, so the
+ * gestures never slow down scoring. Undo has no double tap, so its double tap
+ * time is zero and every tap is reported as a tap, however quick.
+ */
+static const uint16_t DOUBLE_TAP_MS = 300;
+avr_gesture_detector<
+    2000,
+    DOUBLE_TAP_MS,
+    p1_score_switch,
+    p2_score_switch> score_gestures;
+avr_gesture_detector<1000, 0, undo_switch> undo_gestures;
+
+/**
+ * Set when the players have swapped ends. The scoring buttons, displays and
+ * serve LEDs are named for the player at that end at the start of the match,
+ * so once ends are swapped they belong to the other player.
+ */
+static bool ends_swapped = false;
+
+/**
+ * Set when the displays must be redrawn even though the game hasn't changed.
+ */
+static bool redraw = true;
+avr_seven_segment_display<2> p1_score_display;
+avr_seven_segment_display<1> p1_games_won_display;
+avr_seven_segment_display<2> p2_score_display;
+avr_seven_segment_display<1> p2_games_won_display;
+avr_seven_segment_scanner<
     seven_segment_pins,
-    avr_digital_output_pin_null::instance(),
-    &p2_games_won_digit);
+    p1_score_ones_digit,
+    p1_score_tens_digit,
+    p1_games_won_digit,
+    p2_score_ones_digit,
+    p2_score_tens_digit,
+    p2_games_won_digit> display_scanner;
+
+/**
+ * The rate at which individual digits are lit. The scanner lights all six
+ * digits in turn, so the whole panel refreshes at about 333Hz.
+ */
+static const uint16_t DISPLAY_HZ = 2000;
+using display_timer = avr_timer0_interrupt<DISPLAY_HZ>;
+
+/**
+ * The number of display interrupts per system clock tick.
+ */
+static const uint8_t DISPLAY_TICKS_PER_MS = DISPLAY_HZ / 1000;
+
+/**
+ * The buttons are also polled every eighth display interrupt, i.e. every 4ms,
+ * so that a button that settles after its lockout is still seen correctly.
+ */
+static const uint8_t INPUT_POLL_DIVIDER = 8;
+static_assert(INPUT_POLL_DIVIDER % DISPLAY_TICKS_PER_MS == 0,
+              "Polls must line up with the system clock ticks.");
+
+/**
+ * After ten minutes without any button changing, the displays are blanked and
+ * the MCU powers down until a button changes.
+ */
+static const uint32_t INACTIVITY_MS = 10UL * 60 * 1000;
+
+/**
+ * Multiplexes the displays, lighting one digit per interrupt, ticks the system
+ * clock and polls the buttons. The polls go through the same queues as the pin
+ * change events so the main loop sees every reading in time order.
+ */
+ISR(TIMER0_COMPA_vect) {
+    static uint8_t scans = 0;
+    display_scanner.refresh();
+    if (++scans % DISPLAY_TICKS_PER_MS == 0) {
+        system_clock.tick();
+    }
+    if (scans == INPUT_POLL_DIVIDER) {
+        scans = 0;
+        uint16_t now = system_clock.now();
+        bank_c_capture.capture(now);
+        bank_d_capture.capture(now);
+    }
+}
+
+#ifdef SCORNADO_TELEMETRY
+/**
+ * The telemetry serial port. It only transmits, from PD1, which the telemetry
+ * wiring in scornado_board.hpp leaves free.
+ */
+avr_usart0<38400, 64, 8> telemetry_port;
+
+/**
+ * Determines whether a pin is USART0's TXD pin, PD1.
+ *
+ * @tparam pin_t The pin.
+ *
+ * @returns True if the pin is PD1.
+ */
+template <typename pin_t>
+static constexpr bool is_txd_pin() {
+    return avr_is_same<typename pin_t::bank, avr_io_bank_d>::value &&
+           pin_t::BIT == 1;
+}
+
+static_assert(!is_txd_pin<sevseg_a>() && !is_txd_pin<sevseg_b>() &&
+              !is_txd_pin<sevseg_c>() && !is_txd_pin<sevseg_d>() &&
+              !is_txd_pin<sevseg_e>() && !is_txd_pin<sevseg_f>() &&
+              !is_txd_pin<sevseg_g>() && !is_txd_pin<undo_switch>(),
+              "Telemetry needs a board with nothing else on PD1.");
+
+#ifndef SCORNADO_TABLE
+/**
+ * The number of this table in its telemetry frames, to tell it apart from
+ * others sharing the link. Set it with -DSCORNADO_TABLE=n.
+ */
+#define SCORNADO_TABLE 0
+#endif
+
+/**
+ * Builds the telemetry frames.
+ */
+telemetry_encoder telemetry(SCORNADO_TABLE);
+
+/**
+ * Sends the next queued telemetry byte.
+ */
+ISR(USART_UDRE_vect) {
+    telemetry_port.transmit_next();
+}
+#endif
+
+/**
+ * Reports a change of the game on the telemetry stream, if it is built in. The
+ * frame is queued and sent by the serial port interrupt, and if the queue is
+ * full the frame is dropped rather than waiting. Its sequence number is still
+ * used, so the receiver can tell.
+ *
+ * @param event What changed the game.
+ * @param tt    The game after the change.
+ */
+static void report(telemetry_event event, const table_tennis& tt) {
+#ifdef SCORNADO_TELEMETRY
+    uint8_t frame[TELEMETRY_FRAME_SIZE];
+    telemetry.encode(frame, event, tt, ends_swapped);
+    telemetry_port.write(frame, sizeof(frame));
+#else
+    (void) event;
+    (void) tt;
+#endif
+}
+
+/**
+ * Scores a point and reports it.
+ *
+ * @param tt The game to update.
+ * @param p2 True to score for player two, false for player one.
+ */
+static void score_point(table_tennis& tt, bool p2) {
+    if (p2) {
+        tt.p2_score();
+    } else {
+        tt.p1_score();
+    }
+
+    /**
+     * Winning a game is the only way a point leaves both scores at zero.
+     */
+    bool won = tt.get_p1_score() == 0 && tt.get_p2_score() == 0;
+    report(won ? telemetry_event::game_won : telemetry_event::point, tt);
+}
+
+/**
+ * Captures changes of the bank C buttons as they happen.
+ */
+ISR(PCINT1_vect) {
+    bank_c_capture.capture(system_clock.now());
+}
+
+/**
+ * Captures changes of the bank D buttons as they happen.
+ */
+ISR(PCINT2_vect) {
+    bank_d_capture.capture(system_clock.now());
+}
+
+/**
+ * Acts on the bank C buttons that changed in the last debouncer update.
+ *
+ * @param tt            The game to update.
+ * @param timestamp     The time of the update.
+ * @param count_presses False to ignore presses of the scoring buttons, e.g.
+ *                      when they woke the scorer from power-down. The game
+ *                      mode and first serve switches are always followed.
+ */
+static void handle_bank_c(table_tennis& tt,
+                          uint16_t timestamp,
+                          bool count_presses) {
+    uint8_t version = tt.version();
+    switch (bank_c_buttons.check<game_mode_switch>()) {
+        case avr_button_action::pressed:
+            tt.set_game_mode(table_tennis::game_mode::to_11);
+            break;
+        case avr_button_action::released:
+            tt.set_game_mode(table_tennis::game_mode::to_21);
+            break;
+        case avr_button_action::none:
+            break;
+    }
+    if (tt.version() != version) {
+        report(telemetry_event::game_mode, tt);
+        version = tt.version();
+    }
+
+    switch (bank_c_buttons.check<first_serve_switch>()) {
+        case avr_button_action::pressed:
+            tt.set_first_serve(table_tennis::serve_player::p1);
+            break;
+        case avr_button_action::released:
+            tt.set_first_serve(table_tennis::serve_player::p2);
+            break;
+        case avr_button_action::none:
+            break;
+    }
+    if (tt.version() != version) {
+        report(telemetry_event::first_serve, tt);
+    }
+
+    if (count_presses) {
+        uint8_t p1_end = bank_c_buttons.pressed() & p1_score_switch::MASK;
+        uint8_t p2_end = bank_c_buttons.pressed() & p2_score_switch::MASK;
+        if (ends_swapped ? p2_end : p1_end) {
+            score_point(tt, false);
+        }
+
+        if (ends_swapped ? p1_end : p2_end) {
+            score_point(tt, true);
+        }
+    }
+
+    /**
+     * The presses that made the chord scored a point each, but the new match
+     * clears them.
+     */
+    score_gestures.update(bank_c_buttons.state(), timestamp);
+    if (score_gestures.long_press() ==
+        (p1_score_switch::MASK | p2_score_switch::MASK)) {
+        tt.new_match();
+        report(telemetry_event::new_match, tt);
+    }
+}
+
+/**
+ * Acts on the undo button gestures after the last debouncer update. Undo acts
+ * on release rather than on press so that a long press can swap ends instead.
+ *
+ * @param tt        The game to update.
+ * @param timestamp The time of the update.
+ */
+static void handle_bank_d(table_tennis& tt, uint16_t timestamp) {
+    undo_gestures.update(bank_d_buttons.state(), timestamp);
+    if (undo_gestures.tap()) {
+        uint8_t version = tt.version();
+        tt.undo();
+        if (tt.version() != version) {
+            report(telemetry_event::undo, tt);
+        }
+    }
+
+    if (undo_gestures.long_press()) {
+        ends_swapped = !ends_swapped;
+        redraw = true;
+        report(telemetry_event::ends_swapped, tt);
+    }
+}
+
+/**
+ * Turns off every peripheral the scorer doesn't use: the analog comparator,
+ * the ADC, SPI, TWI, the USART, Timer1 and Timer2. Only Timer0 and the I/O
+ * ports are left running.
+ */
+static void power_down_unused_peripherals() {
+    ACSR |= _BV(ACD);
+    PRR = _BV(PRTWI) | _BV(PRTIM2) | _BV(PRTIM1) | _BV(PRSPI) |
+          _BV(PRUSART0) | _BV(PRADC);
+}
+
+/**
+ * Sleeps until the next interrupt, unless button events are already waiting.
+ * Interrupts are disabled while checking the queues so an event captured just
+ * before sleeping can't be left waiting; the instruction after sei() always
+ * runs before any interrupt, so the sleep starts before the next one is
+ * handled.
+ *
+ * @param mode The sleep mode, SLEEP_MODE_IDLE or SLEEP_MODE_PWR_DOWN.
+ *
+ * @returns True if it slept, false if button events were already waiting.
+ */
+static bool sleep_until_interrupt(uint8_t mode) {
+    set_sleep_mode(mode);
+    cli();
+    bool sleep = bank_c_capture.empty() && bank_d_capture.empty();
+    if (sleep) {
+        sleep_enable();
+        if (mode == SLEEP_MODE_PWR_DOWN) {
+            /**
+             * The brown-out detector isn't needed while powered down.
+             */
+            sleep_bod_disable();
+        }
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
+    sei();
+    return sleep;
+}
+
+/**
+ * Sleeps in idle mode until the next interrupt. Idle mode stops the CPU but
+ * keeps the timers and pin change interrupts running, so the display timer
+ * wakes the main loop every 0.5ms and a button wakes it immediately.
+ */
+static void idle() {
+    sleep_until_interrupt(SLEEP_MODE_IDLE);
+}
+
+/**
+ * Blanks the displays and serve LEDs and powers down until a button changes.
+ * Only the pin change interrupts can wake the MCU from power-down. The game and
+ * the display framebuffers stay in SRAM, so the displays show the same thing
+ * again from the first display interrupt after waking, and the caller must
+ * restore the serve LEDs.
+ *
+ * @returns True if it powered down, false if button events were already
+ *          waiting, in which case they are left for the caller to handle.
+ */
+static bool power_down() {
+    display_timer::stop();
+    display_scanner.blank();
+    serve_leds::off();
+    bool slept = sleep_until_interrupt(SLEEP_MODE_PWR_DOWN);
+    display_timer::start();
+    return slept;
+}
 
 /**
  * Entry point for the program. Processes table tennis games.
  */
 int main (int, char**) {
     table_tennis tt;
+    power_down_unused_peripherals();
+#ifdef SCORNADO_TELEMETRY
+    telemetry_port.start_transmitter();
+#endif
+    serve_leds::init();
+    display_scanner.attach(p1_score_display);
+    display_scanner.attach(p1_games_won_display);
+    display_scanner.attach(p2_score_display);
+    display_scanner.attach(p2_games_won_display);
+    display_timer::start();
+    bank_c_capture.start();
+    bank_d_capture.start();
+    sei();
+
+    /**
+     * The version of the game last drawn. The first pass draws regardless.
+     */
+    uint8_t rendered_version = tt.version();
+
+    /**
+     * When a button last changed.
+     */
+    uint32_t last_activity = system_clock.now();
+
+    /**
+     * Cleared for the pass after waking from power-down, so the button press
+     * that woke the scorer doesn't also score a point, undo one or start a
+     * gesture.
+     */
+    bool count_presses = true;
     while (true) {
         /**
          * Handle inputs.
          */
-        switch (game_mode_button.check()) {
-            case avr_button::action::pressed:
-                tt.set_game_mode(table_tennis::game_mode::to_11);
-                break;
-            case avr_button::action::released:
-                tt.set_game_mode(table_tennis::game_mode::to_21);
-                break;
-            case avr_button::action::none:
-                break;
+        bool active = false;
+        avr_pin_change_event event;
+        while (bank_c_capture.pop(event)) {
+            bank_c_buttons.update(event.pins, event.timestamp);
+            active |= bank_c_buttons.pressed() | bank_c_buttons.released();
+            handle_bank_c(tt, event.timestamp, count_presses);
         }
 
-        switch (first_serve_button.check()) {
-            case avr_button::action::pressed:
-                tt.set_first_serve(table_tennis::serve_player::p1);
-                break;
-            case avr_button::action::released:
-                tt.set_first_serve(table_tennis::serve_player::p2);
-                break;
-            case avr_button::action::none:
-                break;
+        while (bank_d_capture.pop(event)) {
+            bank_d_buttons.update(event.pins, event.timestamp);
+            active |= bank_d_buttons.pressed() | bank_d_buttons.released();
+            handle_bank_d(tt, event.timestamp);
         }
 
-        if (undo_button.check() == avr_button::action::pressed) {
-            tt.undo();
+        if (!count_presses) {
+            score_gestures.cancel();
+            undo_gestures.cancel();
+            count_presses = true;
         }
 
-        if (p1_score_button.check() == avr_button::action::pressed) {
-            tt.p1_score();
+        /**
+         * Handle outputs, only when the game has changed. At most a queue's
+         * worth of events are handled between checks, far fewer than the 256
+         * changes it takes for the version to wrap.
+         */
+        if (redraw || tt.version() != rendered_version) {
+            redraw = false;
+            rendered_version = tt.version();
+            bool p1_serves = tt.serve() == table_tennis::serve_player::p1;
+            serve_leds::show(p1_serves != ends_swapped);
+            p1_score_display.display_decimal(
+                ends_swapped ? tt.get_p2_score() : tt.get_p1_score());
+            p1_games_won_display.display_decimal(
+                ends_swapped ? tt.get_p2_games_won() : tt.get_p1_games_won());
+            p2_score_display.display_decimal(
+                ends_swapped ? tt.get_p1_score() : tt.get_p2_score());
+            p2_games_won_display.display_decimal(
+                ends_swapped ? tt.get_p1_games_won() : tt.get_p2_games_won());
         }
 
-        if (p2_score_button.check() == avr_button::action::pressed) {
-            tt.p2_score();
+        uint32_t now = system_clock.now();
+        if (active) {
+            last_activity = now;
         }
 
-        /**
-         * Handle outputs.
-         */
-        p1_serve_led.set(tt.serve() == table_tennis::serve_player::p1);
-        p2_serve_led.set(!(tt.serve() == table_tennis::serve_player::p1));
-        p1_score_display.display_decimal(tt.get_p1_score());
-        p1_games_won_display.display_decimal(tt.get_p1_games_won());
-        p2_score_display.display_decimal(tt.get_p2_score());
-        p2_games_won_display.display_decimal(tt.get_p2_games_won());
+        if (now - last_activity >= INACTIVITY_MS) {
+            /**
+             * If events arrived just before powering down then no button
+             * woke the scorer, so they're handled as usual on the next pass.
+             */
+            if (power_down()) {
+                count_presses = false;
+                last_activity = system_clock.now();
+            }
+            redraw = true;
+        } else {
+            idle();
+        }
     }
 
     return 0;
@@ -0,0 +1,726 @@
+/**
+ * Aggregates the telemetry of many scornado units on a Linux host, e.g. to
+ * drive the scoreboards of a whole venue.
+ *
+ *     scornado_aggregator [-s socket] port...
+ *
+ * Each port is a serial port, pty or fifo carrying the telemetry stream of one
+ * or more units, see scornado_telemetry.hpp. The ports are read concurrently
+ * with epoll and every frame is decoded in place in the receive buffer. The
+ * state of each table, looked up by its port, numbered from 0 in the order
+ * given, and its table number, is kept in memory and every change is
+ * published on stdout as one JSON object per line:
+ *
+ *     {"port":0,"table":3,"seq":17,"event":"point","p1":5,"p2":3,"p1_games":1,
+ *      "p2_games":0,"serving":"p2","to":11,"ends_swapped":false}
+ *
+ * Each batch of reads is flushed to stdout before waiting again, so updates
+ * are published as soon as they are received. If a socket path is given, a
+ * client connecting to that UNIX socket is sent the current state of every
+ * table, in the same format, and the connection is closed. The state is taken
+ * when the client connects and sent as fast as the client reads it, between
+ * reads of the ports, so a slow client never holds up the telemetry. A client
+ * that has not read it all within a second is disconnected.
+ *
+ * The aggregator stops when every port has closed or on SIGINT or SIGTERM,
+ * and then writes its statistics to stderr as a JSON object.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "scornado_telemetry.hpp"
+
+/**
+ * The size of the receive buffer of each port. A unit sends a frame for each
+ * change of its game, so this holds hundreds of frames.
+ */
+static const size_t RECEIVE_BUFFER_SIZE = 4096;
+
+/**
+ * The most frames a gap in a table's sequence numbers is taken to have lost.
+ * A frame further ahead than this, or behind, is out of order: a duplicate, a
+ * frame overtaken by a later one, or the first frame after the unit restarted.
+ */
+static const uint8_t MAX_LOST_FRAMES = 127;
+
+/**
+ * How far behind a table's last frame an out of order frame can be and still
+ * be taken for a duplicate or an overtaken frame, which is dropped so that it
+ * cannot wind the table's state back. Frames further behind are taken to come
+ * from a unit that restarted, and are accepted.
+ */
+static const uint8_t MAX_STALE_FRAMES = 32;
+
+/**
+ * The largest number of epoll events handled in one batch.
+ */
+static const int MAX_EVENTS = 64;
+
+/**
+ * The most snapshot clients served at once. More are disconnected straight
+ * away.
+ */
+static const uint32_t MAX_SNAPSHOT_CLIENTS = 8;
+
+/**
+ * How long a snapshot client has to read the snapshot, in nanoseconds.
+ */
+static const uint64_t SNAPSHOT_TIMEOUT_NS = 1000000000;
+
+/**
+ * The epoll tags of the signal and snapshot sockets. Snapshot clients are
+ * tagged with their slot plus FIRST_CLIENT_TAG, and ports with their index
+ * plus FIRST_PORT_TAG.
+ */
+static const uint32_t SIGNAL_TAG = 0;
+static const uint32_t SNAPSHOT_TAG = 1;
+static const uint32_t FIRST_CLIENT_TAG = 2;
+static const uint32_t FIRST_PORT_TAG = FIRST_CLIENT_TAG + MAX_SNAPSHOT_CLIENTS;
+
+/**
+ * The last known state of a table.
+ */
+struct table_state {
+    /**
+     * Whether a frame has been received from the table.
+     */
+    bool seen;
+
+    /**
+     * The sequence number expected in the table's next frame.
+     */
+    uint8_t next_sequence;
+
+    /**
+     * The table's last frame, decoded.
+     */
+    uint8_t sequence;
+    telemetry_event event;
+    uint8_t p1_score;
+    uint8_t p2_score;
+    uint8_t p1_games_won;
+    uint8_t p2_games_won;
+    uint8_t flags;
+};
+
+/**
+ * A port telemetry is read from.
+ */
+struct telemetry_port {
+    /**
+     * The path the port was opened from.
+     */
+    const char* path;
+
+    /**
+     * The file descriptor of the port, or -1 once it has closed.
+     */
+    int fd;
+
+    /**
+     * Whether bytes are being thrown away up to the next frame, after a frame
+     * that was too long to be valid.
+     */
+    bool discarding;
+
+    /**
+     * The number of bytes at the start of the buffer belonging to a frame
+     * that has not all been received yet.
+     */
+    size_t pending;
+
+    /**
+     * The receive buffer.
+     */
+    uint8_t buffer[RECEIVE_BUFFER_SIZE];
+
+    /**
+     * Every table the port can carry, indexed by table number.
+     */
+    table_state tables[256];
+};
+
+/**
+ * A client of the snapshot socket being sent the snapshot.
+ */
+struct snapshot_client {
+    /**
+     * The connection, or -1 if the slot is free.
+     */
+    int fd;
+
+    /**
+     * The snapshot, allocated by open_memstream().
+     */
+    char* data;
+
+    /**
+     * The number of bytes in the snapshot.
+     */
+    size_t size;
+
+    /**
+     * The number of bytes sent so far.
+     */
+    size_t sent;
+
+    /**
+     * When the client is disconnected if it has not read the whole snapshot,
+     * from now_ns().
+     */
+    uint64_t deadline_ns;
+};
+
+/**
+ * What the aggregator has seen, written to stderr when it stops.
+ */
+struct aggregator_stats {
+    uint64_t frames;
+    uint64_t bad_frames;
+    uint64_t lost_frames;
+    uint64_t out_of_order_frames;
+    uint64_t batches;
+    uint64_t total_batch_ns;
+    uint64_t max_batch_ns;
+};
+
+/**
+ * The statistics.
+ */
+static aggregator_stats stats;
+
+/**
+ * Gets the time from a monotonic clock.
+ *
+ * @returns The time, in nanoseconds.
+ */
+static uint64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Gets the name of a telemetry event.
+ *
+ * @param event The event.
+ *
+ * @returns The name.
+ */
+static const char* event_name(telemetry_event event) {
+    switch (event) {
+        case telemetry_event::point: return "point";
+        case telemetry_event::game_won: return "game_won";
+        case telemetry_event::undo: return "undo";
+        case telemetry_event::game_mode: return "game_mode";
+        case telemetry_event::first_serve: return "first_serve";
+        case telemetry_event::new_match: return "new_match";
+        case telemetry_event::ends_swapped: return "ends_swapped";
+    }
+    return "unknown";
+}
+
+/**
+ * Writes the state of a table as a JSON object on its own line.
+ *
+ * @param out   Where to write the state.
+ * @param port  The index of the table's port.
+ * @param table The number of the table.
+ * @param state The state of the table.
+ */
+static void write_table(FILE* out,
+                        size_t port,
+                        uint8_t table,
+                        const table_state& state) {
+    std::fprintf(out,
+                 "{\"port\":%zu,\"table\":%u,\"seq\":%u,\"event\":\"%s\","
+                 "\"p1\":%u,\"p2\":%u,\"p1_games\":%u,\"p2_games\":%u,"
+                 "\"serving\":\"%s\",\"to\":%u,\"ends_swapped\":%s}\n",
+                 port,
+                 table,
+                 state.sequence,
+                 event_name(state.event),
+                 state.p1_score,
+                 state.p2_score,
+                 state.p1_games_won,
+                 state.p2_games_won,
+                 state.flags & TELEMETRY_FLAG_P2_SERVING ? "p2" : "p1",
+                 state.flags & TELEMETRY_FLAG_TO_21 ? 21 : 11,
+                 state.flags & TELEMETRY_FLAG_ENDS_SWAPPED ? "true" : "false");
+}
+
+/**
+ * Decodes a frame received on a port, updates its table and publishes it.
+ *
+ * @param ports The ports.
+ * @param index The index of the port the frame was received on.
+ * @param data The frame, without the zero byte that ended it. It is
+ *             overwritten by the decoding.
+ * @param size The number of bytes in the frame, at most the size of a receive
+ *             buffer.
+ */
+static void handle_frame(std::vector<telemetry_port>& ports,
+                         size_t index,
+                         uint8_t* data,
+                         size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    telemetry_frame frame;
+    if (!telemetry_decode(data, static_cast<uint16_t>(size), frame)) {
+        ++stats.bad_frames;
+        return;
+    }
+
+    ++stats.frames;
+    table_state& state = ports[index].tables[frame.table()];
+    if (state.seen) {
+        uint8_t gap = frame.sequence() - state.next_sequence;
+        if (gap != 0 && gap <= MAX_LOST_FRAMES) {
+            stats.lost_frames += gap;
+        } else if (gap != 0) {
+            ++stats.out_of_order_frames;
+            if (static_cast<uint8_t>(-gap) <= MAX_STALE_FRAMES) {
+                return;
+            }
+        }
+    }
+    state.seen = true;
+    state.next_sequence = frame.sequence() + 1;
+    state.sequence = frame.sequence();
+    state.event = frame.event();
+    state.p1_score = frame.p1_score();
+    state.p2_score = frame.p2_score();
+    state.p1_games_won = frame.p1_games_won();
+    state.p2_games_won = frame.p2_games_won();
+    state.flags = frame.flags();
+    write_table(stdout, index, frame.table(), state);
+}
+
+/**
+ * Reads what is available on a port and handles every frame it completes.
+ *
+ * @param ports The ports.
+ * @param index The index of the port to read.
+ *
+ * @returns False if the port has closed.
+ */
+static bool read_port(std::vector<telemetry_port>& ports, size_t index) {
+    telemetry_port& port = ports[index];
+    ssize_t count = read(port.fd,
+                         port.buffer + port.pending,
+                         sizeof(port.buffer) - port.pending);
+    if (count < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return true;
+    }
+    if (count <= 0) {
+        return false;
+    }
+
+    size_t end = port.pending + count;
+    size_t start = 0;
+    for (size_t i = port.pending; i < end; ++i) {
+        if (port.buffer[i] == 0) {
+            if (port.discarding) {
+                port.discarding = false;
+            } else {
+                handle_frame(ports, index, port.buffer + start, i - start);
+            }
+            start = i + 1;
+        }
+    }
+
+    /**
+     * Keep an unfinished frame for the next read, unless it is already too
+     * long, in which case skip to the start of the next one.
+     */
+    port.pending = end - start;
+    if (port.discarding || port.pending >= TELEMETRY_FRAME_SIZE) {
+        if (!port.discarding) {
+            ++stats.bad_frames;
+        }
+        port.discarding = true;
+        port.pending = 0;
+    } else {
+        std::memmove(port.buffer, port.buffer + start, port.pending);
+    }
+    return true;
+}
+
+/**
+ * Opens a port for reading. A terminal is put in raw mode at the telemetry
+ * baud rate.
+ *
+ * @param path The path of the port.
+ *
+ * @returns The file descriptor, or -1 if the port could not be opened.
+ */
+static int open_port(const char* path) {
+    int fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (isatty(fd)) {
+        termios tio;
+        if (tcgetattr(fd, &tio) == 0) {
+            cfmakeraw(&tio);
+            cfsetspeed(&tio, B38400);
+            tcsetattr(fd, TCSANOW, &tio);
+        }
+    }
+    return fd;
+}
+
+/**
+ * Opens the UNIX socket the state of every table is served on.
+ *
+ * @param path The path of the socket. Anything already there is replaced.
+ *
+ * @returns The file descriptor, or -1 if the socket could not be opened.
+ */
+static int open_snapshot_socket(const char* path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    std::strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(fd, 16) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Disconnects a snapshot client and frees its slot.
+ *
+ * @param client The client.
+ */
+static void close_client(snapshot_client& client) {
+    close(client.fd);
+    std::free(client.data);
+    client.fd = -1;
+    client.data = nullptr;
+}
+
+/**
+ * Sends as much of the snapshot as a client will take without waiting.
+ *
+ * @param client The client.
+ *
+ * @returns True if the client is done with, because it has been sent the
+ *          whole snapshot or has gone away, false if there is more to send.
+ */
+static bool send_snapshot(snapshot_client& client) {
+    while (client.sent < client.size) {
+        ssize_t count = send(client.fd,
+                             client.data + client.sent,
+                             client.size - client.sent,
+                             MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0 && errno == EAGAIN) {
+            return false;
+        }
+        if (count <= 0) {
+            return true;
+        }
+        client.sent += count;
+    }
+    return true;
+}
+
+/**
+ * Accepts a client of the snapshot socket and takes the state of every table
+ * for it. As much as the client will take is sent straight away, and if that
+ * isn't everything the client is watched for room to send the rest.
+ *
+ * @param listener The snapshot socket.
+ * @param epoll_fd The epoll instance.
+ * @param clients  The snapshot client slots.
+ * @param ports    The ports.
+ */
+static void accept_snapshot(int listener,
+                            int epoll_fd,
+                            snapshot_client (&clients)[MAX_SNAPSHOT_CLIENTS],
+                            const std::vector<telemetry_port>& ports) {
+    int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    uint32_t slot = 0;
+    while (slot < MAX_SNAPSHOT_CLIENTS && clients[slot].fd >= 0) {
+        ++slot;
+    }
+    if (slot == MAX_SNAPSHOT_CLIENTS) {
+        close(fd);
+        return;
+    }
+
+    snapshot_client& client = clients[slot];
+    FILE* out = open_memstream(&client.data, &client.size);
+    if (out == nullptr) {
+        close(fd);
+        return;
+    }
+    for (size_t port = 0; port < ports.size(); ++port) {
+        for (unsigned table = 0; table < 256; ++table) {
+            const table_state& state = ports[port].tables[table];
+            if (state.seen) {
+                write_table(out, port, table, state);
+            }
+        }
+    }
+    std::fclose(out);
+    client.fd = fd;
+    client.sent = 0;
+    client.deadline_ns = now_ns() + SNAPSHOT_TIMEOUT_NS;
+
+    epoll_event event;
+    event.events = EPOLLOUT;
+    event.data.u32 = FIRST_CLIENT_TAG + slot;
+    if (send_snapshot(client) ||
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        close_client(client);
+    }
+}
+
+/**
+ * Disconnects the snapshot clients that are out of time.
+ *
+ * @param clients The snapshot client slots.
+ * @param now     The time, from now_ns().
+ *
+ * @returns How long until the next client runs out of time, in milliseconds
+ *          rounded up, or -1 if there are no clients left.
+ */
+static int expire_clients(snapshot_client (&clients)[MAX_SNAPSHOT_CLIENTS],
+                          uint64_t now) {
+    int timeout = -1;
+    for (snapshot_client& client : clients) {
+        if (client.fd < 0) {
+            continue;
+        }
+        if (now >= client.deadline_ns) {
+            close_client(client);
+            continue;
+        }
+        int left = static_cast<int>((client.deadline_ns - now + 999999) /
+                                    1000000);
+        if (timeout < 0 || left < timeout) {
+            timeout = left;
+        }
+    }
+    return timeout;
+}
+
+/**
+ * Writes the statistics to stderr as a JSON object.
+ *
+ * @param seconds How long the aggregator ran.
+ */
+static void report_stats(double seconds) {
+    std::fprintf(stderr,
+                 "{\"frames\":%llu,\"bad_frames\":%llu,\"lost_frames\":%llu,"
+                 "\"out_of_order_frames\":%llu,\"frames_per_s\":%.0f,"
+                 "\"avg_batch_us\":%.1f,\"max_batch_us\":%.1f}\n",
+                 static_cast<unsigned long long>(stats.frames),
+                 static_cast<unsigned long long>(stats.bad_frames),
+                 static_cast<unsigned long long>(stats.lost_frames),
+                 static_cast<unsigned long long>(stats.out_of_order_frames),
+                 seconds > 0 ? stats.frames / seconds : 0.0,
+                 stats.batches ? stats.total_batch_ns / 1000.0 /
+                                 stats.batches : 0.0,
+                 stats.max_batch_ns / 1000.0);
+}
+
+/**
+ * Entry point for the aggregator.
+ */
+int main(int argc, char** argv) {
+    const char* snapshot_path = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        if (opt == 's') {
+            snapshot_path = optarg;
+        } else {
+            std::fprintf(stderr, "usage: %s [-s socket] port...\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind == argc) {
+        std::fprintf(stderr, "usage: %s [-s socket] port...\n", argv[0]);
+        return 2;
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        std::perror("epoll_create1");
+        return 1;
+    }
+    epoll_event event;
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        std::perror("signalfd");
+        return 1;
+    }
+    event.events = EPOLLIN;
+    event.data.u32 = SIGNAL_TAG;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &event) < 0) {
+        std::perror("epoll_ctl");
+        return 1;
+    }
+
+    int snapshot_fd = -1;
+    snapshot_client clients[MAX_SNAPSHOT_CLIENTS];
+    for (snapshot_client& client : clients) {
+        client.fd = -1;
+        client.data = nullptr;
+    }
+    if (snapshot_path != nullptr) {
+        snapshot_fd = open_snapshot_socket(snapshot_path);
+        if (snapshot_fd < 0) {
+            std::perror(snapshot_path);
+            return 1;
+        }
+        event.events = EPOLLIN;
+        event.data.u32 = SNAPSHOT_TAG;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, snapshot_fd, &event) < 0) {
+            std::perror("epoll_ctl");
+            return 1;
+        }
+    }
+
+    /**
+     * The ports never move once opened, as their buffers are decoded in place.
+     */
+    std::vector<telemetry_port> ports(argc - optind);
+    for (size_t i = 0; i < ports.size(); ++i) {
+        telemetry_port& port = ports[i];
+        port.path = argv[optind + i];
+        port.fd = open_port(port.path);
+        port.discarding = false;
+        port.pending = 0;
+        if (port.fd < 0) {
+            std::perror(port.path);
+            return 1;
+        }
+        event.events = EPOLLIN;
+        event.data.u32 = FIRST_PORT_TAG + i;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, port.fd, &event) < 0) {
+            std::perror(port.path);
+            return 1;
+        }
+    }
+
+    /**
+     * Stdout is flushed once per batch rather than once per line.
+     */
+    static char output_buffer[1 << 16];
+    std::setvbuf(stdout, output_buffer, _IOFBF, sizeof(output_buffer));
+
+    uint64_t start = now_ns();
+    size_t open_ports = ports.size();
+    bool running = true;
+    int timeout = -1;
+    while (running && open_ports > 0) {
+        epoll_event events[MAX_EVENTS];
+        int count = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::perror("epoll_wait");
+            break;
+        }
+
+        uint64_t batch_start = now_ns();
+        uint64_t frames = stats.frames;
+        for (int i = 0; i < count; ++i) {
+            uint32_t tag = events[i].data.u32;
+            if (tag == SIGNAL_TAG) {
+                running = false;
+            } else if (tag == SNAPSHOT_TAG) {
+                accept_snapshot(snapshot_fd, epoll_fd, clients, ports);
+            } else if (tag < FIRST_PORT_TAG) {
+                snapshot_client& client = clients[tag - FIRST_CLIENT_TAG];
+                if (client.fd >= 0 && send_snapshot(client)) {
+                    close_client(client);
+                }
+            } else {
+                size_t index = tag - FIRST_PORT_TAG;
+                telemetry_port& port = ports[index];
+                if (port.fd >= 0 && !read_port(ports, index)) {
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, port.fd, nullptr);
+                    close(port.fd);
+                    port.fd = -1;
+                    --open_ports;
+                }
+            }
+        }
+
+        /**
+         * How long a batch takes from the wakeup to the flush. This is not
+         * the latency from a frame arriving, which also includes the time the
+         * frame waited in the kernel before the wakeup.
+         */
+        if (stats.frames != frames) {
+            std::fflush(stdout);
+            uint64_t batch_ns = now_ns() - batch_start;
+            ++stats.batches;
+            stats.total_batch_ns += batch_ns;
+            if (batch_ns > stats.max_batch_ns) {
+                stats.max_batch_ns = batch_ns;
+            }
+        }
+        timeout = expire_clients(clients, now_ns());
+    }
+
+    for (snapshot_client& client : clients) {
+        if (client.fd >= 0) {
+            close_client(client);
+        }
+    }
+
+    std::fflush(stdout);
+    report_stats((now_ns() - start) / 1e9);
+    if (snapshot_path != nullptr) {
+        unlink(snapshot_path);
+    }
+    return 0;
+}
@@ -0,0 +1,562 @@
+/**
+ * Cycle-count benchmarks for the scornado firmware, meant to be run under the
+ * simavr simulator.
+ *
+ * Each benchmark times a piece of the firmware many times with Timer1 counting
+ * system clock cycles, and the results are written to the simavr console
+ * register, one JSON object per line:
+ *
+ *     {"bench":"table_tennis::p1_score","n":256,"min":92,"avg":110,"max":301}
+ *
+ * All counts are in cycles with the cost of reading the timer removed. The
+ * duty_cycle line is different: it measures how much of the time the main loop
+ * is awake when it sleeps between display interrupts, see bench_duty_cycle().
+ * So is the telemetry::rate line, which measures the frames per second the
+ * serial port carries, see bench_telemetry().
+ * When every benchmark has run the firmware sleeps with interrupts disabled,
+ * which makes simavr exit.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include <avr/avr_mcu_section.h>
+
+#include "avr_io.hpp"
+#include "scornado_board.hpp"
+#include "scornado_telemetry.hpp"
+#include "table_tennis.hpp"
+
+/**
+ * Tell simavr which part this is for and where the console register is.
+ */
+AVR_MCU(F_CPU, "atmega328p");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+/**
+ * Writes a string to the simavr console.
+ *
+ * @param str The string to write.
+ */
+static void console_write(const char* str) {
+    while (*str) {
+        GPIOR0 = *str++;
+    }
+}
+
+/**
+ * Writes an unsigned number to the simavr console in decimal.
+ *
+ * @param number The number to write.
+ */
+static void console_write(uint32_t number) {
+    char buffer[11];
+    uint8_t i = sizeof(buffer);
+    buffer[--i] = '\0';
+    do {
+        buffer[--i] = '0' + number % 10;
+        number /= 10;
+    } while (number);
+    console_write(&buffer[i]);
+}
+
+/**
+ * Ends a line on the simavr console, which flushes it to simavr's output.
+ */
+static void console_end_line() {
+    GPIOR0 = '\r';
+}
+
+/**
+ * Prevents the compiler from moving memory accesses across the timer reads.
+ */
+static inline void barrier() {
+    __asm__ __volatile__ ("" ::: "memory");
+}
+
+/**
+ * The number of cycles counted when timing nothing at all.
+ */
+static uint32_t timer_overhead = 0;
+
+/**
+ * Counts the cycles taken by a function call. Timer1 must be running from the
+ * undivided system clock. Calls up to 131071 cycles long are timed correctly.
+ *
+ * @tparam fn_t The type of the function.
+ *
+ * @param fn The function to time.
+ *
+ * @returns The number of cycles taken.
+ */
+template <typename fn_t>
+static uint32_t count_cycles(fn_t fn) {
+    TIFR1 = _BV(TOV1);
+    TCNT1 = 0;
+    barrier();
+    fn();
+    barrier();
+    uint32_t cycles = TCNT1;
+    if (TIFR1 & _BV(TOV1)) {
+        cycles += 0x10000;
+    }
+    return cycles - timer_overhead;
+}
+
+/**
+ * Accumulates the cycle counts of one benchmark and reports them.
+ */
+struct bench_stats {
+    /**
+     * Creates an empty set of statistics.
+     *
+     * @param name The name reported for the benchmark.
+     */
+    bench_stats(const char* name):
+        _name(name) {
+    }
+
+    /**
+     * Times a function call and adds it to the statistics.
+     *
+     * @tparam fn_t The type of the function.
+     *
+     * @param fn The function to time.
+     */
+    template <typename fn_t>
+    void time(fn_t fn) {
+        uint32_t cycles = count_cycles(fn);
+        _total += cycles;
+        _min = cycles < _min ? cycles : _min;
+        _max = cycles > _max ? cycles : _max;
+        ++_count;
+    }
+
+    /**
+     * Writes the statistics to the simavr console as a JSON object.
+     */
+    void report() const {
+        console_write("{\"bench\":\"");
+        console_write(_name);
+        console_write("\",\"n\":");
+        console_write(_count);
+        console_write(",\"min\":");
+        console_write(_count ? _min : 0);
+        console_write(",\"avg\":");
+        console_write(_count ? _total / _count : 0);
+        console_write(",\"max\":");
+        console_write(_max);
+        console_write("}");
+        console_end_line();
+    }
+
+private:
+    const char* _name;
+    uint32_t _total = 0;
+    uint32_t _min = 0xFFFFFFFF;
+    uint32_t _max = 0;
+    uint32_t _count = 0;
+};
+
+/**
+ * A small pseudo-random number generator so every run sees the same inputs.
+ *
+ * @returns The next pseudo-random byte.
+ */
+static uint8_t next_random() {
+    static uint16_t lfsr = 0xACE1;
+    lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xB400);
+    return lfsr;
+}
+
+/**
+ * The firmware objects being benchmarked, set up the same way as in
+ * scornado.cpp.
+ */
+avr_button<p1_score_switch> p1_score_button;
+avr_port_debouncer<
+    game_mode_switch,
+    first_serve_switch,
+    p1_score_switch,
+    p2_score_switch> bank_c_debouncer;
+avr_edge_debouncer<
+    20,
+    game_mode_switch,
+    first_serve_switch,
+    p1_score_switch,
+    p2_score_switch> bank_c_buttons;
+avr_seven_segment_display<2> p1_score_display;
+avr_seven_segment_display<1> p1_games_won_display;
+avr_seven_segment_display<2> p2_score_display;
+avr_seven_segment_display<1> p2_games_won_display;
+avr_seven_segment_scanner<
+    seven_segment_pins,
+    p1_score_ones_digit,
+    p1_score_tens_digit,
+    p1_games_won_digit,
+    p2_score_ones_digit,
+    p2_score_tens_digit,
+    p2_games_won_digit> display_scanner;
+table_tennis tt;
+
+/**
+ * Bank C events for the main loop benchmarks. The benchmark can't drive the
+ * pins, so the events are made up, either by the benchmark itself or by the
+ * display timer interrupt below.
+ */
+avr_isr_queue<avr_pin_change_event, 8> bank_c_events;
+
+/**
+ * The display timer, at the same rate as in scornado.cpp.
+ */
+using display_timer = avr_timer0_interrupt<2000>;
+
+/**
+ * The number of display timer interrupts handled.
+ */
+static volatile uint16_t display_ticks = 0;
+
+/**
+ * The cycles spent in the display timer interrupt, not counting the entry and
+ * exit sequences generated by the compiler.
+ */
+static volatile uint32_t display_isr_cycles = 0;
+
+/**
+ * Does the work of the scornado.cpp display timer interrupt: lights the next
+ * digit and every eighth tick (4ms) queues a poll of the buttons. Every 512th
+ * tick (256ms) the poll shows player one's button pressed, so the game keeps
+ * changing at a brisk rally pace. Also keeps count of its own cycles.
+ */
+ISR(TIMER0_COMPA_vect) {
+    uint16_t start = TCNT1;
+    display_scanner.refresh();
+    uint16_t ticks = display_ticks + 1;
+    display_ticks = ticks;
+    if (ticks % 8 == 0) {
+        uint8_t pins = 0xFF;
+        if (ticks % 512 == 0) {
+            pins &= ~p1_score_switch::MASK;
+        }
+
+        /**
+         * Timestamps are in milliseconds, two display ticks each.
+         */
+        bank_c_events.push(avr_pin_change_event {
+            static_cast<uint16_t>(ticks / 2), pins });
+    }
+    display_isr_cycles += static_cast<uint16_t>(TCNT1 - start);
+}
+
+/**
+ * Times the input handling.
+ */
+static void bench_inputs() {
+    bench_stats button_check("avr_button::check");
+    bench_stats debouncer_sample("avr_port_debouncer::sample");
+    bench_stats edge_update("avr_edge_debouncer::update");
+    bench_stats queue_push("avr_isr_queue::push");
+    bench_stats queue_pop("avr_isr_queue::pop");
+    static avr_isr_queue<avr_pin_change_event, 8> queue;
+    for (uint16_t i = 0; i < 256; ++i) {
+        button_check.time([] { p1_score_button.check(); });
+        debouncer_sample.time([] { bank_c_debouncer.sample(); });
+        uint8_t reading = next_random();
+        uint16_t timestamp = i * 4;
+        edge_update.time([=] { bank_c_buttons.update(reading, timestamp); });
+        queue_push.time([=] {
+            queue.push(avr_pin_change_event { timestamp, reading });
+        });
+        queue_pop.time([] {
+            avr_pin_change_event event;
+            queue.pop(event);
+        });
+    }
+    button_check.report();
+    debouncer_sample.report();
+    edge_update.report();
+    queue_push.report();
+    queue_pop.report();
+}
+
+/**
+ * Times the display rendering and multiplexing.
+ */
+static void bench_display() {
+    bench_stats display_decimal("avr_seven_segment_display::display_decimal");
+    bench_stats refresh("avr_seven_segment_scanner::refresh");
+    for (uint16_t i = 0; i < 100; ++i) {
+        uint8_t number = i;
+        display_decimal.time([=] {
+            p1_score_display.display_decimal(number);
+        });
+        refresh.time([] { display_scanner.refresh(); });
+    }
+    display_decimal.report();
+    refresh.report();
+}
+
+/**
+ * Times the game logic over a few pseudo-random matches.
+ */
+static void bench_table_tennis() {
+    bench_stats p1_score("table_tennis::p1_score");
+    bench_stats p2_score("table_tennis::p2_score");
+    bench_stats serve("table_tennis::serve");
+    bench_stats undo("table_tennis::undo");
+    for (uint16_t i = 0; i < 1024; ++i) {
+        uint8_t random = next_random();
+        if (random < 112) {
+            p1_score.time([] { tt.p1_score(); });
+        } else if (random < 224) {
+            p2_score.time([] { tt.p2_score(); });
+        } else {
+            undo.time([] { tt.undo(); });
+        }
+        serve.time([] { tt.serve(); });
+    }
+    p1_score.report();
+    p2_score.report();
+    serve.report();
+    undo.report();
+}
+
+/**
+ * The telemetry serial port, set up as in scornado.cpp.
+ */
+avr_usart0<38400, 64, 8> telemetry_port;
+telemetry_encoder telemetry(0);
+
+/**
+ * Sends the next queued telemetry byte.
+ */
+ISR(USART_UDRE_vect) {
+    telemetry_port.transmit_next();
+}
+
+/**
+ * Receives a byte. start() enables the receive interrupt, and without a
+ * handler a byte arriving on the simulated UART would reset the benchmark.
+ */
+ISR(USART_RX_vect) {
+    telemetry_port.receive();
+}
+
+/**
+ * Times sending telemetry frames. "telemetry::send" is the cost to the main
+ * loop of building and queueing a frame, which includes the interrupt that
+ * sends the first byte. "telemetry::drain" is the time until the interrupts
+ * have handed the whole frame to the port, which is set by the baud rate and
+ * is spent sleeping or doing other work in the firmware. Then the port is kept
+ * busy with frames to measure how many the line carries per second:
+ *
+ *     {"bench":"telemetry::rate","frames":64,"cycles":...,"frames_per_s":...}
+ *
+ * At 38400 baud this should be about 320. Under simavr the frames come out of
+ * the simulated UART.
+ */
+static void bench_telemetry() {
+    bench_stats send("telemetry::send");
+    bench_stats drain("telemetry::drain");
+    telemetry_port.start();
+    sei();
+    for (uint16_t i = 0; i < 64; ++i) {
+        tt.p1_score();
+        send.time([] {
+            uint8_t frame[TELEMETRY_FRAME_SIZE];
+            telemetry.encode(frame, telemetry_event::point, tt, false);
+            telemetry_port.write(frame, sizeof(frame));
+        });
+        while (!telemetry_port.idle()) {
+        }
+
+        drain.time([] {
+            uint8_t frame[TELEMETRY_FRAME_SIZE];
+            telemetry.encode(frame, telemetry_event::point, tt, false);
+            telemetry_port.write(frame, sizeof(frame));
+            while (!telemetry_port.idle()) {
+            }
+        });
+    }
+    send.report();
+    drain.report();
+
+    /**
+     * Timer1 overflows every 4ms, far longer than a pass of this loop, so the
+     * overflows are counted as it waits for room in the queue.
+     */
+    static const uint16_t RATE_FRAMES = 64;
+    uint8_t frame[TELEMETRY_FRAME_SIZE];
+    telemetry.encode(frame, telemetry_event::point, tt, false);
+    uint16_t frames = 0;
+    uint32_t overflows = 0;
+    TIFR1 = _BV(TOV1);
+    TCNT1 = 0;
+    while (frames < RATE_FRAMES || !telemetry_port.idle()) {
+        if (frames < RATE_FRAMES &&
+            telemetry_port.write(frame, sizeof(frame))) {
+            ++frames;
+            telemetry.encode(frame, telemetry_event::point, tt, false);
+        }
+        if (TIFR1 & _BV(TOV1)) {
+            TIFR1 = _BV(TOV1);
+            ++overflows;
+        }
+    }
+    uint16_t count = TCNT1;
+    if ((TIFR1 & _BV(TOV1)) && count < 0x8000) {
+        ++overflows;
+    }
+    cli();
+    uint32_t cycles = (overflows << 16) + count;
+
+    console_write("{\"bench\":\"telemetry::rate\",\"frames\":");
+    console_write(static_cast<uint32_t>(RATE_FRAMES));
+    console_write(",\"cycles\":");
+    console_write(cycles);
+    console_write(",\"frames_per_s\":");
+    console_write(static_cast<uint32_t>(F_CPU * RATE_FRAMES / cycles));
+    console_write("}");
+    console_end_line();
+}
+
+/**
+ * One pass of the scornado.cpp main loop, without the sleep, with bank C's
+ * events coming from bank_c_events: handling the events and rendering the
+ * outputs if the game changed.
+ */
+static void main_loop_pass() {
+    static uint8_t rendered_version = tt.version() - 1;
+    avr_pin_change_event event;
+    while (bank_c_events.pop(event)) {
+        bank_c_buttons.update(event.pins, event.timestamp);
+        if (bank_c_buttons.pressed() & p1_score_switch::MASK) {
+            tt.p1_score();
+        }
+        if (bank_c_buttons.pressed() & p2_score_switch::MASK) {
+            tt.p2_score();
+        }
+    }
+    if (tt.version() != rendered_version) {
+        rendered_version = tt.version();
+        bool p1_serves = tt.serve() == table_tennis::serve_player::p1;
+        serve_leds::show(p1_serves);
+        p1_score_display.display_decimal(tt.get_p1_score());
+        p1_games_won_display.display_decimal(tt.get_p1_games_won());
+        p2_score_display.display_decimal(tt.get_p2_score());
+        p2_games_won_display.display_decimal(tt.get_p2_games_won());
+    }
+}
+
+/**
+ * Times passes of the main loop when a button event is waiting and when
+ * nothing has happened. The events are made up rather than captured since the
+ * benchmark can't drive the pins.
+ */
+static void bench_main_loop() {
+    bench_stats loop("main_loop");
+    bench_stats idle("main_loop_idle");
+    for (uint16_t i = 0; i < 256; ++i) {
+        bank_c_events.push(avr_pin_change_event {
+            static_cast<uint16_t>(i * 4), next_random() });
+        loop.time([] { main_loop_pass(); });
+        idle.time([] { main_loop_pass(); });
+    }
+    loop.report();
+    idle.report();
+}
+
+/**
+ * Runs the scornado.cpp main loop, sleeping in idle mode between passes, for
+ * two seconds of simulated time with the display timer interrupt running, and
+ * reports how many of the cycles the CPU was awake for:
+ *
+ *     {"bench":"duty_cycle","ticks":4000,"cycles":32000000,"awake":...,
+ *      "permille":...}
+ *
+ * "permille" is the awake cycles per thousand. Time spent in interrupt
+ * handlers counts as awake, apart from the few cycles of the compiler's entry
+ * and exit sequences and the wake-up delay, which count as asleep. The supply
+ * current is roughly the active current times the awake fraction plus the idle
+ * current times the rest.
+ */
+static void bench_duty_cycle() {
+    static const uint16_t TICKS = 4000;
+    uint32_t total = 0;
+    uint32_t asleep = 0;
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+    display_ticks = 0;
+    display_timer::start();
+    uint16_t last = TCNT1;
+    while (display_ticks < TICKS) {
+        sei();
+        main_loop_pass();
+        cli();
+        if (bank_c_events.empty()) {
+            uint32_t isr_cycles = display_isr_cycles;
+            uint16_t sleep_start = TCNT1;
+            sleep_enable();
+            sei();
+            sleep_cpu();
+            sleep_disable();
+            cli();
+            asleep += static_cast<uint16_t>(TCNT1 - sleep_start) -
+                      (display_isr_cycles - isr_cycles);
+        }
+
+        /**
+         * Each pass is shorter than a display tick, well within Timer1's
+         * range.
+         */
+        uint16_t now = TCNT1;
+        total += static_cast<uint16_t>(now - last);
+        last = now;
+    }
+    display_timer::stop();
+
+    console_write("{\"bench\":\"duty_cycle\",\"ticks\":");
+    console_write(static_cast<uint32_t>(TICKS));
+    console_write(",\"cycles\":");
+    console_write(total);
+    console_write(",\"awake\":");
+    console_write(total - asleep);
+    console_write(",\"permille\":");
+    console_write((total - asleep) / (total / 1000));
+    console_write("}");
+    console_end_line();
+}
+
+/**
+ * Entry point for the benchmarks.
+ */
+int main (int, char**) {
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+    timer_overhead = count_cycles([] {});
+
+    serve_leds::init();
+    display_scanner.attach(p1_score_display);
+    display_scanner.attach(p1_games_won_display);
+    display_scanner.attach(p2_score_display);
+    display_scanner.attach(p2_games_won_display);
+
+    bench_inputs();
+    bench_display();
+    bench_table_tennis();
+    bench_main_loop();
+    bench_duty_cycle();
+    bench_telemetry();
+
+    /**
+     * Sleeping with interrupts disabled makes simavr exit.
+     */
+    cli();
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_mode();
+    return 0;
+}
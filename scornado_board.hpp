@@ -0,0 +1,158 @@
+/**
+ * Pin assignments for the scornado board.
+ *
+ * Boards built with SCORNADO_TELEMETRY send telemetry from USART0's TXD pin,
+ * PD1, which the plain board uses for segment B. On those boards segment B is
+ * wired to PC1 instead, and both serve LEDs share PC0, see
+ * board_shared_serve_leds. The receiver is never enabled, so segment A keeps
+ * the RXD pin, PD0.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#ifndef __SCORNADO_BOARD_HPP__
+#define __SCORNADO_BOARD_HPP__
+
+#include "avr_io.hpp"
+
+/**
+ * The kinds of pin on the board: outputs, and switches that close to ground
+ * and so read through the pin's pull-up.
+ *
+ * @tparam bank_t The avr_io_bank_* type of the pin's I/O bank.
+ * @tparam bit_t  The bit (0-7) of the pin in the bank.
+ */
+template <typename bank_t, uint8_t bit_t>
+using board_output_pin = avr_digital_output_pin<bank_t, bit_t>;
+template <typename bank_t, uint8_t bit_t>
+using board_switch_pin = avr_digital_input_pin<bank_t, bit_t, true>;
+
+/**
+ * Assign low-level pin assignments. The atmega328p has three I/O banks and we
+ * use all of them.
+ */
+using sevseg_a            = board_output_pin<avr_io_bank_d, 0>; /* Pin 2  */
+#ifdef SCORNADO_TELEMETRY
+using sevseg_b            = board_output_pin<avr_io_bank_c, 1>; /* Pin 24 */
+#else
+using sevseg_b            = board_output_pin<avr_io_bank_d, 1>; /* Pin 3  */
+#endif
+using sevseg_c            = board_output_pin<avr_io_bank_d, 2>; /* Pin 4  */
+using sevseg_d            = board_output_pin<avr_io_bank_d, 3>; /* Pin 5  */
+using sevseg_e            = board_output_pin<avr_io_bank_d, 4>; /* Pin 6  */
+using sevseg_f            = board_output_pin<avr_io_bank_d, 5>; /* Pin 11 */
+using sevseg_g            = board_output_pin<avr_io_bank_d, 6>; /* Pin 12 */
+using undo_switch         = board_switch_pin<avr_io_bank_d, 7>; /* Pin 13 */
+using p1_games_won_digit  = board_output_pin<avr_io_bank_b, 0>; /* Pin 14 */
+using p1_score_ones_digit = board_output_pin<avr_io_bank_b, 1>; /* Pin 15 */
+using p1_score_tens_digit = board_output_pin<avr_io_bank_b, 2>; /* Pin 16 */
+using p2_games_won_digit  = board_output_pin<avr_io_bank_b, 3>; /* Pin 17 */
+using p2_score_ones_digit = board_output_pin<avr_io_bank_b, 4>; /* Pin 18 */
+using p2_score_tens_digit = board_output_pin<avr_io_bank_b, 5>; /* Pin 19 */
+#ifdef SCORNADO_TELEMETRY
+using serve_led           = board_output_pin<avr_io_bank_c, 0>; /* Pin 23 */
+#else
+using p1_serve_led        = board_output_pin<avr_io_bank_c, 0>; /* Pin 23 */
+using p2_serve_led        = board_output_pin<avr_io_bank_c, 1>; /* Pin 24 */
+#endif
+using game_mode_switch    = board_switch_pin<avr_io_bank_c, 2>; /* Pin 25 */
+using first_serve_switch  = board_switch_pin<avr_io_bank_c, 3>; /* Pin 26 */
+using p1_score_switch     = board_switch_pin<avr_io_bank_c, 4>; /* Pin 27 */
+using p2_score_switch     = board_switch_pin<avr_io_bank_c, 5>; /* Pin 28 */
+
+/**
+ * Serve LEDs with a pin each.
+ *
+ * @tparam p1_pin_t The output pin of player one's serve LED.
+ * @tparam p2_pin_t The output pin of player two's serve LED.
+ */
+template <typename p1_pin_t, typename p2_pin_t>
+struct board_serve_leds {
+    /**
+     * Initializes the pins as outputs.
+     */
+    static void init() {
+        p1_pin_t::init();
+        p2_pin_t::init();
+    }
+
+    /**
+     * Lights one player's serve LED and turns off the other's.
+     *
+     * @param p1 True to light player one's LED, false to light player two's.
+     */
+    static void show(bool p1) {
+        p1_pin_t::set(p1);
+        p2_pin_t::set(!p1);
+    }
+
+    /**
+     * Turns off both serve LEDs.
+     */
+    static void off() {
+        p1_pin_t::set(false);
+        p2_pin_t::set(false);
+    }
+};
+
+/**
+ * Serve LEDs sharing one pin: player one's LED is wired from the pin to
+ * ground and player two's from the supply to the pin, so driving the pin high
+ * lights player one's and driving it low lights player two's. Letting the pin
+ * float turns both off, as long as the two LEDs' forward voltages add up to
+ * more than the supply, e.g. blue or white LEDs at 5V.
+ *
+ * @tparam pin_t The output pin the LEDs share.
+ */
+template <typename pin_t>
+struct board_shared_serve_leds {
+    /**
+     * Leaves the pin floating, with both LEDs off, until show() is called.
+     */
+    static void init() {
+        off();
+    }
+
+    /**
+     * Lights one player's serve LED and turns off the other's.
+     *
+     * @param p1 True to light player one's LED, false to light player two's.
+     */
+    static void show(bool p1) {
+        pin_t::set(p1);
+        pin_t::init();
+    }
+
+    /**
+     * Turns off both serve LEDs by making the pin a floating input.
+     */
+    static void off() {
+        pin_t::bank::ddr() &= ~pin_t::MASK;
+        pin_t::set(false);
+    }
+};
+
+/**
+ * The serve LEDs.
+ */
+#ifdef SCORNADO_TELEMETRY
+using serve_leds = board_shared_serve_leds<serve_led>;
+#else
+using serve_leds = board_serve_leds<p1_serve_led, p2_serve_led>;
+#endif
+
+/**
+ * The segment pins shared by every digit.
+ */
+using seven_segment_pins = avr_seven_segment_pins<
+    sevseg_a,
+    sevseg_b,
+    sevseg_c,
+    sevseg_d,
+    sevseg_e,
+    sevseg_f,
+    sevseg_g,
+    avr_digital_output_pin_null>;
+
+#endif /* __SCORNADO_BOARD_HPP__ */
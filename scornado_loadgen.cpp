@@ -0,0 +1,499 @@
+/**
+ * Generates the telemetry of many virtual scornado units, to load whatever
+ * consumes it, e.g. scornado_aggregator.
+ *
+ *     scornado_loadgen [-n units] [-r rate] [-c count] [-t seconds]
+ *                      [-u undo_permille] [-s seed] [-w ms] target...
+ *
+ * Each unit plays its own match with the real table_tennis rules and reports
+ * every change in the format of scornado_telemetry.hpp, as the firmware does.
+ * Every step picks a unit at random, which then undoes its last point with
+ * the given chance per thousand or else scores a point for a random player.
+ * A match ends when a player has won three games.
+ *
+ * The units are shared evenly between the targets, each of which is one link
+ * and so holds at most 256 units, numbered from 0 within the link. A target is
+ * one of:
+ *
+ *     pty        A new pty, whose path is written to stdout. Start the
+ *                consumer within the start delay (-w) of the paths appearing.
+ *     unix:PATH  A connection to the UNIX stream socket at PATH.
+ *     PATH       The file or fifo at PATH, truncated first.
+ *
+ * Frames are sent at the given rate in frames per second, or as fast as the
+ * targets take them if the rate is 0, until the count or the time runs out.
+ * Everything is decided by a pseudo-random generator seeded with the seed, so
+ * the same options always send the same bytes. When done the number of frames
+ * and bytes the targets took, the achieved throughput and a digest of the
+ * frames made are written to stderr as a JSON object, so runs can be compared.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "scornado_telemetry.hpp"
+#include "table_tennis.hpp"
+
+/**
+ * The games a player needs to win the match.
+ */
+static const int MATCH_GAMES = 3;
+
+/**
+ * The most frames queued for a target before they are written.
+ */
+static const size_t BATCH_FRAMES = 256;
+
+/**
+ * The most units one target can carry, one per table number.
+ */
+static const size_t UNITS_PER_TARGET = 256;
+
+/**
+ * A pseudo-random generator, xorshift64*. The standard library distributions
+ * are not the same everywhere, so decisions are made from its output
+ * directly to keep runs reproducible between machines.
+ */
+struct load_random {
+    /**
+     * Creates a generator.
+     *
+     * @param seed The seed. Any value, including 0, may be used.
+     */
+    explicit load_random(uint64_t seed):
+        _state(seed ^ 0x9E3779B97F4A7C15ULL) {
+        if (_state == 0) {
+            _state = 1;
+        }
+    }
+
+    /**
+     * Gets the next pseudo-random number.
+     *
+     * @returns The number.
+     */
+    uint64_t next() {
+        _state ^= _state >> 12;
+        _state ^= _state << 25;
+        _state ^= _state >> 27;
+        return _state * 0x2545F4914F6CDD1DULL;
+    }
+
+    /**
+     * Gets a pseudo-random number below a limit.
+     *
+     * @param limit The limit, which must not be 0.
+     *
+     * @returns The number.
+     */
+    uint32_t below(uint32_t limit) {
+        return static_cast<uint32_t>(((next() >> 32) * limit) >> 32);
+    }
+
+private:
+    /**
+     * The state of the generator.
+     */
+    uint64_t _state;
+};
+
+/**
+ * A virtual scornado unit.
+ */
+struct load_unit {
+    /**
+     * Creates a unit.
+     *
+     * @param table The number of the unit in its target.
+     */
+    explicit load_unit(uint8_t table):
+        telemetry(table) {
+    }
+
+    /**
+     * The unit's game.
+     */
+    table_tennis tt;
+
+    /**
+     * Builds the unit's telemetry frames.
+     */
+    telemetry_encoder telemetry;
+};
+
+/**
+ * Where frames are sent.
+ */
+struct load_target {
+    /**
+     * The file descriptor frames are written to.
+     */
+    int fd;
+
+    /**
+     * The consumer's end of a pty target, or -1 for other targets.
+     */
+    int device;
+
+    /**
+     * The frames waiting to be written.
+     */
+    uint8_t buffer[BATCH_FRAMES * TELEMETRY_FRAME_SIZE];
+
+    /**
+     * The number of bytes in the buffer.
+     */
+    size_t size;
+};
+
+/**
+ * The number of bytes the targets have taken.
+ */
+static uint64_t bytes_sent = 0;
+
+/**
+ * The FNV-1a digest of every frame made, in the order they were made, which
+ * does not depend on how they were batched.
+ */
+static uint64_t digest = 0xCBF29CE484222325ULL;
+
+/**
+ * Gets the time from a monotonic clock.
+ *
+ * @returns The time, in nanoseconds.
+ */
+static uint64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Writes the frames waiting for a target, waiting for the target to take
+ * them all.
+ *
+ * @param target The target.
+ *
+ * @returns False if the target could not be written.
+ */
+static bool flush_target(load_target& target) {
+    size_t done = 0;
+    while (done < target.size) {
+        ssize_t count = write(target.fd,
+                              target.buffer + done,
+                              target.size - done);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        done += count;
+        bytes_sent += count;
+    }
+    target.size = 0;
+    return true;
+}
+
+/**
+ * Queues a frame for a unit's change, writing out the target's frames if its
+ * buffer is full.
+ *
+ * @param target The unit's target.
+ * @param unit   The unit.
+ * @param event  What changed the unit's game.
+ *
+ * @returns False if the target could not be written.
+ */
+static bool send_frame(load_target& target,
+                       load_unit& unit,
+                       telemetry_event event) {
+    uint8_t (&frame)[TELEMETRY_FRAME_SIZE] =
+        *reinterpret_cast<uint8_t (*)[TELEMETRY_FRAME_SIZE]>(
+            target.buffer + target.size);
+    unit.telemetry.encode(frame, event, unit.tt, false);
+    for (uint8_t byte : frame) {
+        digest = (digest ^ byte) * 0x100000001B3ULL;
+    }
+    target.size += TELEMETRY_FRAME_SIZE;
+    return target.size < sizeof(target.buffer) || flush_target(target);
+}
+
+/**
+ * Plays one step of a unit's match, sending the frames for it.
+ *
+ * @param target        The unit's target.
+ * @param unit          The unit.
+ * @param random        The pseudo-random generator.
+ * @param undo_permille The chance of undoing the last point, per thousand.
+ *
+ * @returns The number of frames sent, or -1 if the target could not be
+ *          written.
+ */
+static int step_unit(load_target& target,
+                     load_unit& unit,
+                     load_random& random,
+                     uint32_t undo_permille) {
+    table_tennis& tt = unit.tt;
+    if (random.below(1000) < undo_permille) {
+        uint8_t version = tt.version();
+        tt.undo();
+        if (tt.version() != version) {
+            return send_frame(target, unit, telemetry_event::undo) ? 1 : -1;
+        }
+    }
+
+    if (random.below(2)) {
+        tt.p2_score();
+    } else {
+        tt.p1_score();
+    }
+    bool won = tt.get_p1_score() == 0 && tt.get_p2_score() == 0;
+    if (!send_frame(target,
+                    unit,
+                    won ? telemetry_event::game_won : telemetry_event::point)) {
+        return -1;
+    }
+    if (tt.get_p1_games_won() < MATCH_GAMES &&
+        tt.get_p2_games_won() < MATCH_GAMES) {
+        return 1;
+    }
+    tt.new_match();
+    return send_frame(target, unit, telemetry_event::new_match) ? 2 : -1;
+}
+
+/**
+ * Opens a target.
+ *
+ * @param target Set to the opened target.
+ * @param spec   The target, as given on the command line.
+ *
+ * @returns False if the target could not be opened.
+ */
+static bool open_target(load_target& target, const char* spec) {
+    target.device = -1;
+    target.size = 0;
+    target.fd = -1;
+    if (std::strcmp(spec, "pty") == 0) {
+        int fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+        if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+            return false;
+        }
+
+        /**
+         * Make the pty raw for the consumer, and keep it open so that it
+         * does not hang up while the consumer opens it.
+         */
+        const char* path = ptsname(fd);
+        int device = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+        termios tio;
+        if (device < 0 || tcgetattr(device, &tio) < 0) {
+            return false;
+        }
+        cfmakeraw(&tio);
+        tcsetattr(device, TCSANOW, &tio);
+        std::printf("%s\n", path);
+        target.fd = fd;
+        target.device = device;
+        return true;
+    }
+
+    if (std::strncmp(spec, "unix:", 5) == 0) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (std::strlen(spec + 5) >= sizeof(address.sun_path)) {
+            errno = ENAMETOOLONG;
+            return false;
+        }
+        std::strcpy(address.sun_path, spec + 5);
+        target.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        return target.fd >= 0 &&
+               connect(target.fd,
+                       reinterpret_cast<sockaddr*>(&address),
+                       sizeof(address)) == 0;
+    }
+
+    target.fd = open(spec, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    return target.fd >= 0;
+}
+
+/**
+ * Closes a target. A pty is only closed once the consumer has read everything
+ * sent on it, as closing it throws away what is left.
+ *
+ * @param target The target.
+ */
+static void close_target(load_target& target) {
+    if (target.device >= 0) {
+        int waiting;
+        while (ioctl(target.device, TIOCINQ, &waiting) == 0 && waiting > 0) {
+            usleep(1000);
+        }
+        close(target.device);
+    }
+    close(target.fd);
+}
+
+/**
+ * Writes the usage to stderr.
+ *
+ * @param name The name the program was run as.
+ *
+ * @returns The exit status for a usage error.
+ */
+static int usage(const char* name) {
+    std::fprintf(stderr,
+                 "usage: %s [-n units] [-r rate] [-c count] [-t seconds] "
+                 "[-u undo_permille] [-s seed] [-w ms] target...\n",
+                 name);
+    return 2;
+}
+
+/**
+ * Entry point for the load generator.
+ */
+int main(int argc, char** argv) {
+    uint32_t units = 1000;
+    uint64_t rate = 10000;
+    uint64_t count = 0;
+    double seconds = 10;
+    uint32_t undo_permille = 50;
+    uint64_t seed = 1;
+    uint32_t start_delay_ms = 1000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:c:t:u:s:w:")) != -1) {
+        switch (opt) {
+            case 'n': units = std::strtoul(optarg, nullptr, 0); break;
+            case 'r': rate = std::strtoull(optarg, nullptr, 0); break;
+            case 'c': count = std::strtoull(optarg, nullptr, 0); break;
+            case 't': seconds = std::strtod(optarg, nullptr); break;
+            case 'u': undo_permille = std::strtoul(optarg, nullptr, 0); break;
+            case 's': seed = std::strtoull(optarg, nullptr, 0); break;
+            case 'w': start_delay_ms = std::strtoul(optarg, nullptr, 0); break;
+            default: return usage(argv[0]);
+        }
+    }
+    size_t target_count = argc - optind;
+    if (target_count == 0 || units == 0) {
+        return usage(argv[0]);
+    }
+    if (units > target_count * UNITS_PER_TARGET) {
+        std::fprintf(stderr,
+                     "%s: at most %zu units per target\n",
+                     argv[0],
+                     UNITS_PER_TARGET);
+        return 2;
+    }
+
+    /**
+     * A consumer that goes away fails the write rather than killing the
+     * generator, so the summary still says how much it took.
+     */
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<load_target> targets(target_count);
+    for (size_t i = 0; i < target_count; ++i) {
+        if (!open_target(targets[i], argv[optind + i])) {
+            std::perror(argv[optind + i]);
+            return 1;
+        }
+    }
+    std::fflush(stdout);
+
+    /**
+     * Unit i goes to target i % target_count, so every target has the same
+     * number of units, give or take one.
+     */
+    std::vector<load_unit> fleet;
+    fleet.reserve(units);
+    for (uint32_t i = 0; i < units; ++i) {
+        fleet.emplace_back(static_cast<uint8_t>(i / target_count));
+    }
+
+    usleep(start_delay_ms * 1000);
+
+    load_random random(seed);
+    uint64_t frames = 0;
+    uint64_t start = now_ns();
+    uint64_t end = start + static_cast<uint64_t>(seconds * 1e9);
+    bool failed = false;
+    while (!failed && (count == 0 || frames < count)) {
+        uint64_t now = now_ns();
+        if (count == 0 && now >= end) {
+            break;
+        }
+
+        /**
+         * Send the frames that are due by now, or a batch if there is no
+         * rate, and then write them all out.
+         */
+        uint64_t due = rate ? (now - start) * rate / 1000000000 :
+                              frames + BATCH_FRAMES;
+        if (count != 0 && due > count) {
+            due = count;
+        }
+        if (due <= frames) {
+            usleep(100);
+            continue;
+        }
+        while (frames < due) {
+            uint32_t i = random.below(units);
+            int sent = step_unit(targets[i % target_count],
+                                 fleet[i],
+                                 random,
+                                 undo_permille);
+            if (sent < 0) {
+                failed = true;
+                break;
+            }
+            frames += sent;
+        }
+        for (load_target& target : targets) {
+            if (!failed && !flush_target(target)) {
+                failed = true;
+            }
+        }
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+
+    if (failed) {
+        std::perror("write");
+    }
+
+    /**
+     * Only report what the targets took, not what was made but never
+     * written because a target failed.
+     */
+    uint64_t written = bytes_sent / TELEMETRY_FRAME_SIZE;
+    std::fprintf(stderr,
+                 "{\"units\":%u,\"seed\":%llu,\"frames\":%llu,\"bytes\":%llu,"
+                 "\"seconds\":%.3f,\"frames_per_s\":%.0f,"
+                 "\"digest\":\"%016llx\"}\n",
+                 units,
+                 static_cast<unsigned long long>(seed),
+                 static_cast<unsigned long long>(written),
+                 static_cast<unsigned long long>(bytes_sent),
+                 elapsed,
+                 elapsed > 0 ? written / elapsed : 0.0,
+                 static_cast<unsigned long long>(digest));
+    for (load_target& target : targets) {
+        close_target(target);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,1554 @@
+/**
+ * Native benchmarks for the scornado firmware libraries, built against the host
+ * backend in the host directory.
+ *
+ * This exercises the same pieces of the firmware as scornado_bench.cpp but at
+ * the host machine's speed, so the numbers are only useful for comparing
+ * algorithmic changes against each other, not for absolute AVR timings. The
+ * results are written to stdout, one JSON object per line:
+ *
+ *     {"bench":"table_tennis::p1_score","n":1000000,"ns":3.2}
+ *
+ * Before the benchmarks run, every table_tennis_evaluate() kernel this machine
+ * supports and table_tennis_pool are checked against table_tennis, undo is
+ * checked against a model that keeps every state, see verify_undo(), and the
+ * telemetry frames are sent through avr_usart0 and decoded, see
+ * verify_telemetry(). avr_isr_queue is checked between two threads, see
+ * verify_isr_queue(). The debouncers are checked against simple models of
+ * them given bouncing readings, see verify_port_debouncer() and
+ * verify_edge_debouncer(), and the gestures against timed presses, see
+ * verify_gestures(). Every number is drawn on the seven segment displays and
+ * compared with the old division-based rendering, see
+ * verify_display_decimal().
+ * The result of each check is written the same way:
+ *
+ *     {"verify":"table_tennis_evaluate::avx2","games":6424,"failures":0}
+ *
+ * The program fails if any check does.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#include "avr_io.hpp"
+#include "scornado_board.hpp"
+#include "scornado_telemetry.hpp"
+#include "table_tennis.hpp"
+#include "table_tennis_pool.hpp"
+#include "table_tennis_simd.hpp"
+
+/**
+ * The number of times each benchmark runs its function.
+ */
+static const uint32_t ITERATIONS = 1000000;
+
+/**
+ * Times a function over many calls and writes the average time per call to
+ * stdout as a JSON object.
+ *
+ * @tparam fn_t The type of the function.
+ *
+ * @param name The name reported for the benchmark.
+ * @param fn   The function to time. It is passed the iteration number.
+ */
+template <typename fn_t>
+static void bench(const char* name, fn_t fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; ++i) {
+        fn(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::printf("{\"bench\":\"%s\",\"n\":%u,\"ns\":%.2f}\n",
+                name, ITERATIONS, ns / ITERATIONS);
+}
+
+/**
+ * A small pseudo-random number generator so every run sees the same inputs.
+ *
+ * @returns The next pseudo-random byte.
+ */
+static uint8_t next_random() {
+    static uint16_t lfsr = 0xACE1;
+    lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xB400);
+    return lfsr;
+}
+
+/**
+ * The names of the table_tennis_evaluate() kernels, indexed by kernel.
+ */
+static const char* const KERNEL_NAMES[] = { "scalar", "sse2", "avx2" };
+
+/**
+ * Games for table_tennis_evaluate(), with the results expected for them. An
+ * expected result of 0xFF is not checked.
+ */
+struct evaluate_cases {
+    std::vector<uint8_t> p1_score;
+    std::vector<uint8_t> p2_score;
+    std::vector<uint8_t> to_21;
+    std::vector<uint8_t> p2_serves_first;
+    std::vector<uint8_t> deuce;
+    std::vector<uint8_t> winner;
+    std::vector<uint8_t> p2_serving;
+
+    /**
+     * Adds a game.
+     */
+    void add(uint8_t p1, uint8_t p2, bool to_21_game, bool p2_first,
+             uint8_t expect_deuce, uint8_t expect_winner,
+             uint8_t expect_p2_serving) {
+        p1_score.push_back(p1);
+        p2_score.push_back(p2);
+        to_21.push_back(to_21_game);
+        p2_serves_first.push_back(p2_first);
+        deuce.push_back(expect_deuce);
+        winner.push_back(expect_winner);
+        p2_serving.push_back(expect_p2_serving);
+    }
+};
+
+/**
+ * Finds every score a game can reach by playing points from the start, in
+ * both game modes and with either player serving first, and for each the
+ * result table_tennis gives for it and for the point after it. A long deuce
+ * folds back to one point past deuce each, so there are only a few hundred.
+ *
+ * @returns The games, with the results from table_tennis.
+ */
+static evaluate_cases reachable_games() {
+    evaluate_cases cases;
+    for (int mode = 0; mode < 2; ++mode) {
+        for (int first = 0; first < 2; ++first) {
+            table_tennis start;
+            start.set_game_mode(mode ? table_tennis::game_mode::to_21
+                                     : table_tennis::game_mode::to_11);
+            start.set_first_serve(first ? table_tennis::serve_player::p2
+                                        : table_tennis::serve_player::p1);
+            static bool seen[256][256];
+            for (auto& row : seen) {
+                for (bool& cell : row) {
+                    cell = false;
+                }
+            }
+            seen[0][0] = true;
+            std::vector<table_tennis> pending(1, start);
+            while (!pending.empty()) {
+                table_tennis tt = pending.back();
+                pending.pop_back();
+                uint8_t p1 = tt.get_p1_score();
+                uint8_t p2 = tt.get_p2_score();
+                cases.add(p1, p2, mode, first, tt.deuce(), 0,
+                          tt.serve() == table_tennis::serve_player::p2);
+
+                /**
+                 * Score each player's next point. If it wins the game then
+                 * only the winner can be checked, as table_tennis has already
+                 * moved on to the next game.
+                 */
+                for (int scorer = 0; scorer < 2; ++scorer) {
+                    table_tennis next = tt;
+                    if (scorer) {
+                        next.p2_score();
+                    } else {
+                        next.p1_score();
+                    }
+                    uint8_t winner =
+                        next.get_p1_games_won() != tt.get_p1_games_won() ? 1 :
+                        next.get_p2_games_won() != tt.get_p2_games_won() ? 2 :
+                        0;
+                    uint8_t next_p1 = p1 + !scorer;
+                    uint8_t next_p2 = p2 + scorer;
+                    if (winner) {
+                        cases.add(next_p1, next_p2, mode, first, 0xFF, winner,
+                                  0xFF);
+                    } else if (!seen[next_p1][next_p2]) {
+                        seen[next_p1][next_p2] = true;
+                        pending.push_back(next);
+                    }
+                }
+            }
+        }
+    }
+    return cases;
+}
+
+/**
+ * Evaluates games with a kernel and counts the results that differ from the
+ * expected ones.
+ *
+ * @param kernel The kernel.
+ * @param cases  The games.
+ *
+ * @returns The number of games with a wrong result.
+ */
+static uint32_t count_failures(table_tennis_kernel kernel,
+                               const evaluate_cases& cases) {
+    size_t count = cases.p1_score.size();
+    std::vector<uint8_t> deuce(count);
+    std::vector<uint8_t> winner(count);
+    std::vector<uint8_t> p2_serving(count);
+    table_tennis_lanes lanes = {
+        cases.p1_score.data(),
+        cases.p2_score.data(),
+        cases.to_21.data(),
+        cases.p2_serves_first.data(),
+        deuce.data(),
+        winner.data(),
+        p2_serving.data()
+    };
+    table_tennis_evaluate(kernel, lanes, count);
+
+    uint32_t failures = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if ((cases.deuce[i] != 0xFF && cases.deuce[i] != deuce[i]) ||
+            cases.winner[i] != winner[i] ||
+            (cases.p2_serving[i] != 0xFF &&
+             cases.p2_serving[i] != p2_serving[i])) {
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+/**
+ * Checks every kernel this machine supports, first against table_tennis for
+ * every game it can reach, and then against the scalar kernel for every
+ * possible input, and writes the results to stdout.
+ *
+ * @returns True if every kernel gave the right results.
+ */
+static bool verify_kernels() {
+    evaluate_cases reachable = reachable_games();
+
+    evaluate_cases every_input;
+    for (int p1 = 0; p1 < 256; ++p1) {
+        for (int p2 = 0; p2 < 256; ++p2) {
+            for (int variant = 0; variant < 4; ++variant) {
+                every_input.add(p1, p2, variant & 1, variant >> 1, 0, 0, 0);
+            }
+        }
+    }
+    table_tennis_lanes scalar = {
+        every_input.p1_score.data(),
+        every_input.p2_score.data(),
+        every_input.to_21.data(),
+        every_input.p2_serves_first.data(),
+        every_input.deuce.data(),
+        every_input.winner.data(),
+        every_input.p2_serving.data()
+    };
+    table_tennis_evaluate(table_tennis_kernel::scalar,
+                          scalar,
+                          every_input.p1_score.size());
+
+    bool passed = true;
+    for (int i = 0; i < 3; ++i) {
+        table_tennis_kernel kernel = static_cast<table_tennis_kernel>(i);
+        if (!table_tennis_kernel_supported(kernel)) {
+            continue;
+        }
+        uint32_t failures = count_failures(kernel, reachable) +
+                            count_failures(kernel, every_input);
+        std::printf("{\"verify\":\"table_tennis_evaluate::%s\","
+                    "\"games\":%zu,\"failures\":%u}\n",
+                    KERNEL_NAMES[i],
+                    reachable.p1_score.size() + every_input.p1_score.size(),
+                    failures);
+        passed = passed && failures == 0;
+    }
+    return passed;
+}
+
+/**
+ * The number of matches in the pool checked by verify_pool().
+ */
+static const uint32_t POOL_MATCHES = 64;
+
+/**
+ * Compares every match of a pool with the table_tennis given the same points
+ * and settings: the scores, games won, settings, serve and deuce, the last
+ * two both from the pool's accessors and from table_tennis_pool::evaluate().
+ *
+ * @param pool  The pool.
+ * @param games The games, one per match.
+ *
+ * @returns The number of matches that differ.
+ */
+static uint32_t compare_pool(const table_tennis_pool& pool,
+                             const std::vector<table_tennis>& games) {
+    std::vector<uint8_t> deuce(pool.size());
+    std::vector<uint8_t> p2_serving(pool.size());
+    std::vector<uint8_t> winner(pool.size());
+    pool.evaluate(deuce.data(), p2_serving.data(), winner.data());
+
+    uint32_t failures = 0;
+    for (uint32_t i = 0; i < pool.size(); ++i) {
+        const table_tennis& tt = games[i];
+        bool p2_serves = tt.serve() == table_tennis::serve_player::p2;
+        if (pool.get_p1_score(i) != tt.get_p1_score() ||
+            pool.get_p2_score(i) != tt.get_p2_score() ||
+            pool.get_p1_games_won(i) != tt.get_p1_games_won() ||
+            pool.get_p2_games_won(i) != tt.get_p2_games_won() ||
+            pool.get_game_mode(i) != tt.get_game_mode() ||
+            pool.get_first_serve(i) != tt.get_first_serve() ||
+            pool.serve(i) != tt.serve() ||
+            deuce[i] != tt.deuce() ||
+            p2_serving[i] != p2_serves ||
+            winner[i] != 0) {
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+/**
+ * Plays the same pseudo-random points, game mode and first server changes and
+ * new matches on a table_tennis_pool and on a table_tennis per match, with the
+ * points given to the pool in batches, and compares them after every batch.
+ * Then one match plays a deuce long enough to wrap the scores if they were not
+ * folded, which player one must then win, and another wins more games than
+ * can be counted. Writes the result to stdout.
+ *
+ * @returns True if the pool always matched table_tennis.
+ */
+static bool verify_pool() {
+    table_tennis_pool pool(POOL_MATCHES);
+    std::vector<table_tennis> games(POOL_MATCHES);
+    std::vector<table_tennis_pool::point_event> batch;
+    uint32_t checks = 0;
+    uint32_t failures = 0;
+    auto flush = [&] {
+        pool.apply(batch.data(), batch.size());
+        batch.clear();
+        failures += compare_pool(pool, games);
+        checks += POOL_MATCHES;
+    };
+
+    for (uint32_t step = 0; step < 100000; ++step) {
+        uint32_t match = next_random() % POOL_MATCHES;
+        uint8_t action = next_random();
+        table_tennis& tt = games[match];
+        if (action < 248) {
+            bool p2 = action & 1;
+            batch.push_back(table_tennis_pool::point_event { match, p2 });
+            if (p2) {
+                tt.p2_score();
+            } else {
+                tt.p1_score();
+            }
+            if (batch.size() == 64) {
+                flush();
+            }
+            continue;
+        }
+
+        /**
+         * The pool must have the batch's points before settings change.
+         */
+        flush();
+        if (action < 251) {
+            table_tennis::game_mode mode = action & 1
+                                           ? table_tennis::game_mode::to_21
+                                           : table_tennis::game_mode::to_11;
+            pool.set_game_mode(match, mode);
+            tt.set_game_mode(mode);
+        } else if (action < 254) {
+            table_tennis::serve_player first = action & 1
+                                               ? table_tennis::serve_player::p2
+                                               : table_tennis::serve_player::p1;
+            pool.set_first_serve(match, first);
+            tt.set_first_serve(first);
+        } else {
+            pool.new_match(match);
+            tt.new_match();
+        }
+    }
+    flush();
+
+    pool.new_match(0);
+    games[0].new_match();
+    for (uint32_t point = 0; point < 602; ++point) {
+        bool p2 = point < 600 && (point & 1);
+        batch.push_back(table_tennis_pool::point_event { 0, p2 });
+        if (p2) {
+            games[0].p2_score();
+        } else {
+            games[0].p1_score();
+        }
+        flush();
+        uint8_t won = point < 601 ? 0 : 1;
+        if (games[0].get_p1_games_won() != won ||
+            games[0].get_p2_games_won() != 0 ||
+            games[0].get_p1_score() > 22 ||
+            games[0].get_p2_score() > 22) {
+            ++failures;
+        }
+    }
+
+    pool.new_match(1);
+    games[1].new_match();
+    for (uint32_t point = 0; point < 140 * 21; ++point) {
+        batch.push_back(table_tennis_pool::point_event { 1, 0 });
+        games[1].p1_score();
+    }
+    flush();
+
+    std::printf("{\"verify\":\"table_tennis_pool\",\"matches\":%u,"
+                "\"failures\":%u}\n",
+                checks,
+                failures);
+    return failures == 0;
+}
+
+/**
+ * Everything about a table_tennis game that an undo must restore.
+ */
+struct game_snapshot {
+    int p1_score;
+    int p2_score;
+    int p1_games_won;
+    int p2_games_won;
+    table_tennis::game_mode mode;
+    table_tennis::serve_player first_serve;
+    table_tennis::serve_player serve;
+
+    /**
+     * Takes a snapshot of a game.
+     */
+    explicit game_snapshot(const table_tennis& tt):
+        p1_score(tt.get_p1_score()),
+        p2_score(tt.get_p2_score()),
+        p1_games_won(tt.get_p1_games_won()),
+        p2_games_won(tt.get_p2_games_won()),
+        mode(tt.get_game_mode()),
+        first_serve(tt.get_first_serve()),
+        serve(tt.serve()) {
+    }
+
+    bool operator==(const game_snapshot& other) const {
+        return p1_score == other.p1_score &&
+               p2_score == other.p2_score &&
+               p1_games_won == other.p1_games_won &&
+               p2_games_won == other.p2_games_won &&
+               mode == other.mode &&
+               first_serve == other.first_serve &&
+               serve == other.serve;
+    }
+};
+
+/**
+ * Plays pseudo-random points, undos, runs of hundreds of points or undos,
+ * game mode and first server changes and new matches on a table_tennis, and
+ * checks its undo against a simple model that keeps a snapshot of the whole
+ * game before each of the last 256 points: each undo must restore the last
+ * snapshot, with any setting changed since, and a new match must leave
+ * nothing to undo. Every change must change version() and nothing else may,
+ * and a few settings changes around a game are undone by hand first, see
+ * change() below. table_tennis may run out of points to undo before the
+ * model does, but only once it has undone the last 192 points scored. A
+ * settings change takes a checkpoint and can make it keep fewer, so that is
+ * not checked until 256 points have been scored since one. The model then
+ * forgets the points it can no longer undo. Writes the result to stdout.
+ *
+ * @returns True if table_tennis always matched the model.
+ */
+static bool verify_undo() {
+    table_tennis tt;
+    std::deque<game_snapshot> history;
+
+    /**
+     * The fewest points table_tennis must still be able to undo, and the
+     * points scored since the last settings change, up to 256.
+     */
+    uint32_t kept = 0;
+    uint32_t since_settings = 256;
+    uint32_t points = 0;
+    uint32_t undos = 0;
+    uint32_t exhausted = 0;
+    uint32_t failures = 0;
+
+    /**
+     * Scores a point, keeping a snapshot of the game before it.
+     */
+    auto point = [&](bool p2) {
+        history.push_back(game_snapshot(tt));
+        if (history.size() > 256) {
+            history.pop_front();
+        }
+        if (since_settings < 256) {
+            ++since_settings;
+        } else if (kept < 192) {
+            ++kept;
+        }
+        uint8_t version = tt.version();
+        if (p2) {
+            tt.p2_score();
+        } else {
+            tt.p1_score();
+        }
+        failures += tt.version() == version;
+        ++points;
+    };
+
+    /**
+     * Undoes a point, which must restore the last snapshot. If table_tennis
+     * has run out of points then the model forgets the rest.
+     */
+    auto undo = [&] {
+        uint8_t version = tt.version();
+        tt.undo();
+        if (tt.version() == version) {
+            failures += kept != 0;
+            exhausted += !history.empty();
+            history.clear();
+            return;
+        }
+
+        failures += history.empty() || !(game_snapshot(tt) == history.back());
+        if (!history.empty()) {
+            history.pop_back();
+        }
+        kept -= kept != 0;
+        since_settings -= since_settings != 0;
+        ++undos;
+    };
+
+    /**
+     * Changes the game mode or the first server, which must only take effect,
+     * and change the version, at the start of a game and if the setting is
+     * different. A change takes a checkpoint, so that undoing the points
+     * after it keeps it and undoing the point before it undoes it.
+     */
+    auto change = [&](bool mode, bool to_21_or_p2) {
+        game_snapshot before(tt);
+        uint8_t version = tt.version();
+        table_tennis::game_mode new_mode = to_21_or_p2
+                                           ? table_tennis::game_mode::to_21
+                                           : table_tennis::game_mode::to_11;
+        table_tennis::serve_player new_first = to_21_or_p2
+                                               ? table_tennis::serve_player::p2
+                                               : table_tennis::serve_player::p1;
+        bool start = before.p1_score == 0 && before.p2_score == 0;
+        bool changes;
+        if (mode) {
+            tt.set_game_mode(new_mode);
+            changes = start && before.mode != new_mode;
+            failures += tt.get_game_mode() != (changes ? new_mode
+                                                       : before.mode);
+        } else {
+            tt.set_first_serve(new_first);
+            changes = start && before.first_serve != new_first;
+            failures += tt.get_first_serve() != (changes ? new_first
+                                                         : before.first_serve);
+        }
+        failures += (tt.version() != version) != changes;
+        if (changes) {
+            kept = 0;
+            since_settings = 0;
+        } else {
+            failures += !(game_snapshot(tt) == before);
+        }
+        return changes;
+    };
+
+    /**
+     * Change both settings between two games and in the middle of the next,
+     * and undo back through them.
+     */
+    for (int i = 0; i < 11; ++i) {
+        point(false);
+    }
+    failures += !change(true, true) || change(true, true);
+    failures += !change(false, true) || change(false, true);
+    point(true);
+    failures += change(true, false) || change(false, false);
+    undo();
+    failures += tt.get_game_mode() != table_tennis::game_mode::to_21 ||
+                tt.get_first_serve() != table_tennis::serve_player::p2;
+    undo();
+    failures += tt.get_game_mode() != table_tennis::game_mode::to_11 ||
+                tt.get_first_serve() != table_tennis::serve_player::p1 ||
+                tt.get_p1_score() != 10;
+
+    for (uint32_t step = 0; step < 40000; ++step) {
+        uint8_t action = next_random();
+        if (action < 144) {
+            point(action & 1);
+        } else if (action < 208) {
+            undo();
+        } else if (action < 216) {
+            for (uint16_t i = next_random() + 100; i > 0; --i) {
+                point(next_random() & 1);
+            }
+        } else if (action < 224) {
+            for (uint16_t i = next_random() + 100; i > 0; --i) {
+                undo();
+            }
+        } else if (action < 254) {
+            change(action & 1, action & 2);
+        } else {
+            uint8_t version = tt.version();
+            tt.new_match();
+            failures += tt.version() == version;
+            history.clear();
+            kept = 0;
+            since_settings = 256;
+            game_snapshot before(tt);
+            version = tt.version();
+            tt.undo();
+            failures += tt.version() != version ||
+                        !(game_snapshot(tt) == before);
+        }
+    }
+    failures += points <= 256 || exhausted == 0;
+
+    std::printf("{\"verify\":\"table_tennis::undo\",\"points\":%u,"
+                "\"undos\":%u,\"exhausted\":%u,\"failures\":%u}\n",
+                points,
+                undos,
+                exhausted,
+                failures);
+    return failures == 0;
+}
+
+/**
+ * The telemetry serial port, set up as in scornado.cpp.
+ */
+avr_usart0<38400, 64, 8> telemetry_port;
+
+/**
+ * What a telemetry frame queued on the port should decode to.
+ */
+struct sent_frame {
+    uint8_t sequence;
+    uint8_t p1_score;
+    uint8_t p2_score;
+    uint8_t p1_games_won;
+    uint8_t p2_games_won;
+};
+
+/**
+ * Sends the telemetry of a pseudo-random game through telemetry_port as the
+ * firmware does, with the port's data register empty interrupt run by hand a
+ * pseudo-random number of times between frames, as if the line were slower or
+ * faster than the game. The bytes the interrupt hands to UDR0 are then split
+ * into frames and decoded. The line must carry exactly the frames the port
+ * accepted, in order, each passing its CRC and decoding to the game it was
+ * built from, and the frames the port turned away for want of room must show
+ * as gaps in the sequence numbers. Frames whose event is not a
+ * telemetry_event must not decode. Writes the result to stdout.
+ *
+ * @returns True if every frame came through.
+ */
+static bool verify_telemetry() {
+    telemetry_encoder telemetry(0);
+    table_tennis tt;
+    std::vector<sent_frame> sent;
+    std::vector<uint8_t> queued;
+    std::vector<uint8_t> line;
+    uint32_t dropped = 0;
+    uint8_t sequence = 0;
+
+    /**
+     * Runs the interrupt handler if the interrupt is enabled, and takes the
+     * byte it sends, if any, off the line.
+     */
+    auto interrupt = [&] {
+        if (UCSR0B & _BV(UDRIE0)) {
+            telemetry_port.transmit_next();
+            if (UCSR0B & _BV(UDRIE0)) {
+                uint8_t byte = UDR0;
+                line.push_back(byte);
+            }
+        }
+    };
+
+    telemetry_port.start();
+    for (uint32_t i = 0; i < 20000; ++i) {
+        uint8_t action = next_random();
+        if (action < 16) {
+            tt.undo();
+        } else if (action & 1) {
+            tt.p2_score();
+        } else {
+            tt.p1_score();
+        }
+
+        uint8_t frame[TELEMETRY_FRAME_SIZE];
+        telemetry.encode(frame, telemetry_event::point, tt, false);
+        if (telemetry_port.write(frame, sizeof(frame))) {
+            queued.insert(queued.end(), frame, frame + sizeof(frame));
+            sent.push_back(sent_frame {
+                sequence,
+                static_cast<uint8_t>(tt.get_p1_score()),
+                static_cast<uint8_t>(tt.get_p2_score()),
+                static_cast<uint8_t>(tt.get_p1_games_won()),
+                static_cast<uint8_t>(tt.get_p2_games_won())
+            });
+        } else {
+            ++dropped;
+        }
+        ++sequence;
+
+        for (uint8_t bytes = next_random() % 32; bytes > 0; --bytes) {
+            interrupt();
+        }
+    }
+    while (UCSR0B & _BV(UDRIE0)) {
+        interrupt();
+    }
+
+    uint32_t failures = line == queued ? 0 : 1;
+    size_t frames = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < line.size(); ++i) {
+        if (line[i] != 0) {
+            continue;
+        }
+        telemetry_frame decoded;
+        if (frames >= sent.size() ||
+            !telemetry_decode(&line[start], i - start, decoded) ||
+            decoded.sequence() != sent[frames].sequence ||
+            decoded.p1_score() != sent[frames].p1_score ||
+            decoded.p2_score() != sent[frames].p2_score ||
+            decoded.p1_games_won() != sent[frames].p1_games_won ||
+            decoded.p2_games_won() != sent[frames].p2_games_won) {
+            ++failures;
+        }
+        ++frames;
+        start = i + 1;
+    }
+    if (frames != sent.size() || start != line.size() || dropped == 0 ||
+        !telemetry_port.idle()) {
+        ++failures;
+    }
+
+    /**
+     * Frames with an event number outside telemetry_event must be refused,
+     * even with a good CRC.
+     */
+    for (uint8_t event = 0; event < 16; ++event) {
+        uint8_t frame[TELEMETRY_FRAME_SIZE];
+        telemetry.encode(frame, static_cast<telemetry_event>(event), tt, false);
+        telemetry_frame decoded;
+        bool valid = event >= 1 && event <= 7;
+        if (telemetry_decode(frame, sizeof(frame) - 1, decoded) != valid ||
+            (valid && decoded.event() != static_cast<telemetry_event>(event))) {
+            ++failures;
+        }
+    }
+
+    std::printf("{\"verify\":\"avr_usart0+telemetry\",\"frames\":%zu,"
+                "\"dropped\":%u,\"bytes\":%zu,\"failures\":%u}\n",
+                frames,
+                dropped,
+                line.size(),
+                failures);
+    return failures == 0;
+}
+
+/**
+ * Fills and drains a queue one item at a time, enough times for its indices
+ * to wrap several times, checking that it holds exactly its capacity, turns
+ * items away when full and gives nothing back when empty, and that the items
+ * come out in order.
+ *
+ * @tparam capacity_t The capacity of the queue.
+ *
+ * @returns The number of failed checks.
+ */
+template <uint8_t capacity_t>
+static uint32_t count_queue_failures() {
+    avr_isr_queue<uint32_t, capacity_t> queue;
+    uint32_t failures = 0;
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+    for (uint32_t round = 0; round < 1000 / capacity_t + 4; ++round) {
+        for (uint32_t i = 0; i < capacity_t; ++i) {
+            failures += !queue.push(pushed++);
+            failures += queue.empty();
+            failures += queue.size() != i + 1;
+        }
+        failures += !queue.full();
+        failures += queue.push(pushed);
+
+        uint32_t item;
+        for (uint32_t i = 0; i < capacity_t; ++i) {
+            failures += !queue.pop(item) || item != popped++;
+            failures += queue.full();
+        }
+        failures += !queue.empty() || queue.size() != 0;
+        failures += queue.pop(item);
+    }
+    return failures;
+}
+
+/**
+ * Checks avr_isr_queue on its own, see count_queue_failures(), and then with
+ * a producer thread pushing numbered items as fast as it can and a consumer
+ * thread popping them, as the interrupt handlers and the main loop do. A
+ * small queue keeps both sides meeting it full and empty, when they give the
+ * other a turn so one core is enough. The consumer must see every item
+ * exactly once and in order. Writes the result to stdout.
+ *
+ * @returns True if the queue never lost, repeated or reordered an item.
+ */
+static bool verify_isr_queue() {
+    static const uint32_t ITEMS = 1000000;
+    uint32_t failures = count_queue_failures<1>() +
+                        count_queue_failures<8>() +
+                        count_queue_failures<128>();
+
+    avr_isr_queue<uint32_t, 4> queue;
+    uint32_t full = 0;
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < ITEMS; ++i) {
+            while (!queue.push(i)) {
+                ++full;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t empty = 0;
+    uint32_t expected = 0;
+    while (expected < ITEMS) {
+        uint32_t item;
+        if (!queue.pop(item)) {
+            ++empty;
+            std::this_thread::yield();
+            continue;
+        }
+        failures += item != expected;
+        expected = item + 1;
+    }
+    producer.join();
+    failures += !queue.empty();
+
+    std::printf("{\"verify\":\"avr_isr_queue\",\"items\":%u,\"full\":%u,"
+                "\"empty\":%u,\"failures\":%u}\n",
+                ITEMS,
+                full,
+                empty,
+                failures);
+    return failures == 0;
+}
+
+/**
+ * Bouncing readings for verify_port_debouncer() to start with. Player one's
+ * switch (bit 4) bounces shut for one, two and three samples before staying
+ * shut for eight, then opens. Player two's (bit 5) is shut from the start and
+ * opens at the same time as player one's. The game mode switch (bit 2)
+ * changes every sample, and bit 0, which no switch uses, every third. The
+ * switches are active low, so a clear bit means shut.
+ */
+static const uint8_t BOUNCING_PINC[] = {
+    0xDA, 0xCF, 0xDB, 0xCE, 0xCB, 0xDF, 0xCA, 0xCF,
+    0xCB, 0xDE, 0xCB, 0xCF, 0xCA, 0xCF, 0xCB, 0xCE,
+    0xCB, 0xCF, 0xFA, 0xFF, 0xFB, 0xFE, 0xFB, 0xFF
+};
+
+/**
+ * The pins that must toggle on each of BOUNCING_PINC's samples: player two's
+ * on its fourth shut sample, player one's on the fourth of its eight, and
+ * both on their fourth open one.
+ */
+static const uint8_t BOUNCING_TOGGLES[] = {
+    0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00
+};
+
+/**
+ * Feeds bouncing readings of bank C to an avr_port_debouncer set up as in
+ * scornado.cpp, first BOUNCING_PINC and then readings in which each bit flips
+ * with a probability of one in eight, so that runs of every length are common.
+ * After each sample the debouncer is compared with a model keeping a separate
+ * count for each pin: a pin toggles on exactly the fourth sample in a row
+ * that disagrees with its debounced state, and a sample that agrees starts
+ * the count again. The bits of other pins are ignored. The model must also
+ * give BOUNCING_TOGGLES. Writes the result to stdout.
+ *
+ * @returns True if the debouncer always matched the model.
+ */
+static bool verify_port_debouncer() {
+    static const uint32_t RANDOM_SAMPLES = 100000;
+    static const uint8_t MASK = 0x3C;
+    avr_port_debouncer<
+        game_mode_switch,
+        first_serve_switch,
+        p1_score_switch,
+        p2_score_switch> debouncer;
+    uint8_t state = 0;
+    uint8_t runs[8] = {};
+    uint32_t toggles = 0;
+    uint32_t glitches = 0;
+    uint32_t failures = 0;
+
+    uint8_t pinc = 0xFF;
+    uint32_t samples = sizeof(BOUNCING_PINC) + RANDOM_SAMPLES;
+    for (uint32_t i = 0; i < samples; ++i) {
+        if (i < sizeof(BOUNCING_PINC)) {
+            pinc = BOUNCING_PINC[i];
+        } else {
+            pinc ^= next_random() & next_random() & next_random();
+        }
+        PINC = pinc;
+
+        uint8_t toggled = 0;
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            uint8_t mask = 1 << bit;
+            if (!(MASK & mask)) {
+                continue;
+            }
+            bool disagrees = ((~pinc ^ state) & mask) != 0;
+            if (!disagrees) {
+                glitches += runs[bit] != 0;
+                runs[bit] = 0;
+            } else if (++runs[bit] == 4) {
+                toggled |= mask;
+                runs[bit] = 0;
+            }
+        }
+        if (i < sizeof(BOUNCING_PINC) && toggled != BOUNCING_TOGGLES[i]) {
+            ++failures;
+        }
+        state ^= toggled;
+        toggles += toggled != 0;
+
+        if (debouncer.sample() != toggled ||
+            debouncer.state() != state ||
+            debouncer.pressed() != (state & toggled) ||
+            debouncer.released() != (~state & toggled)) {
+            ++failures;
+        }
+    }
+
+    if (toggles == 0 || glitches == 0) {
+        ++failures;
+    }
+
+    std::printf("{\"verify\":\"avr_port_debouncer\",\"samples\":%u,"
+                "\"toggles\":%u,\"glitches\":%u,\"failures\":%u}\n",
+                samples,
+                toggles,
+                glitches,
+                failures);
+    return failures == 0;
+}
+
+/**
+ * Checks an avr_edge_debouncer set up as in scornado.cpp, fed the low 16 bits
+ * of a millisecond clock that starts just before the 32 bit clock wraps.
+ * First player one's switch bounces on being pressed and released, with the
+ * first edge of each taken at once and the bounces within the lockout
+ * ignored, while player two's switch is pressed during player one's lockout
+ * and taken at once. The durations and hold times across the wrap must be
+ * right. Then random readings every 0 to 40ms are compared with a model in
+ * which each pin takes a change once 20ms have passed since its last one.
+ * Writes the result to stdout.
+ *
+ * @returns True if the debouncer always did as expected.
+ */
+static bool verify_edge_debouncer() {
+    static const uint16_t LOCKOUT = 20;
+    static const uint32_t RANDOM_READINGS = 100000;
+    static const uint8_t P1 = p1_score_switch::MASK;
+    static const uint8_t P2 = p2_score_switch::MASK;
+    avr_edge_debouncer<
+        LOCKOUT,
+        game_mode_switch,
+        first_serve_switch,
+        p1_score_switch,
+        p2_score_switch> debouncer;
+    uint32_t start = 0xFFFFFFF0;
+    uint32_t failures = 0;
+
+    /**
+     * Feeds a reading, with the given switches shut, and counts a failure if
+     * the switches that change are not the expected ones.
+     */
+    auto feed = [&](uint32_t at, uint8_t shut, uint8_t changed) {
+        failures += debouncer.update(~shut, at) != changed;
+    };
+
+    feed(start, P1, P1);
+    failures += debouncer.check<p1_score_switch>() !=
+                avr_button_action::pressed;
+    feed(start + 1, 0, 0);
+    feed(start + 5, P1, 0);
+    feed(start + 8, P1 | P2, P2);
+    feed(start + 19, P2, 0);
+    failures += debouncer.state() != (P1 | P2);
+    feed(start + 20, P2, P1);
+    failures += debouncer.check<p1_score_switch>() !=
+                avr_button_action::released;
+    failures += debouncer.duration<p1_score_switch>() != 20;
+
+    feed(start + 45, P1 | P2, P1);
+    failures += debouncer.duration<p1_score_switch>() != 25;
+    failures += debouncer.held_for<p1_score_switch>(start + 1045) != 1000;
+    failures += debouncer.held_for<p2_score_switch>(start + 1045) != 1037;
+    feed(start + 3045, P2, P1);
+    failures += debouncer.duration<p1_score_switch>() != 3000;
+    failures += debouncer.held_for<p1_score_switch>(start + 3046) != 0;
+    feed(start + 3046, P1 | P2, 0);
+    feed(start + 3065, 0, P2);
+    failures += debouncer.state() != 0;
+    failures += debouncer.duration<p2_score_switch>() != 3057;
+
+    /**
+     * The model keeps full 32 bit times, so it is unaffected by the wraps.
+     */
+    uint32_t now = start + 3065;
+    uint8_t shut = 0;
+    uint8_t state = 0;
+    uint32_t changed_at[8] = {};
+    uint32_t durations[8] = {};
+    changed_at[2] = changed_at[3] = now - LOCKOUT;
+    changed_at[4] = start + 3045;
+    changed_at[5] = now;
+    durations[4] = 3000;
+    durations[5] = 3057;
+    uint32_t changes = 0;
+    uint32_t ignored = 0;
+    for (uint32_t i = 0; i < RANDOM_READINGS; ++i) {
+        now += next_random() % 41;
+        shut ^= next_random() & next_random();
+
+        uint8_t changed = 0;
+        for (uint8_t bit = 2; bit < 6; ++bit) {
+            uint8_t mask = 1 << bit;
+            if (((shut ^ state) & mask) == 0) {
+                continue;
+            }
+            if (now - changed_at[bit] < LOCKOUT) {
+                ++ignored;
+                continue;
+            }
+            changed |= mask;
+            durations[bit] = now - changed_at[bit];
+            changed_at[bit] = now;
+        }
+        state ^= changed;
+        changes += changed != 0;
+
+        failures += debouncer.update(~shut, now) != changed;
+        failures += debouncer.state() != state ||
+                    debouncer.pressed() != (state & changed) ||
+                    debouncer.released() != (~state & changed);
+        failures += debouncer.duration<p1_score_switch>() != durations[4] ||
+                    debouncer.duration<p2_score_switch>() != durations[5];
+        failures += debouncer.held_for<p1_score_switch>(now + 1) !=
+                    ((state & P1) ? now + 1 - changed_at[4] : 0);
+    }
+    failures += changes == 0 || ignored == 0 || now - start < 0x10000;
+
+    std::printf("{\"verify\":\"avr_edge_debouncer\",\"readings\":%u,"
+                "\"changes\":%u,\"ignored\":%u,\"failures\":%u}\n",
+                RANDOM_READINGS,
+                changes,
+                ignored,
+                failures);
+    return failures == 0;
+}
+
+/**
+ * A debounced state given to an avr_gesture_detector, and the gestures it
+ * must report for it.
+ */
+struct gesture_step {
+    uint16_t at;
+    uint8_t held;
+    uint8_t tap;
+    uint8_t double_tap;
+    uint8_t long_press;
+};
+
+/**
+ * Replays steps through a gesture detector, with every time moved by an
+ * offset, and counts the steps whose gestures are not the expected ones.
+ *
+ * @tparam detector_t The avr_gesture_detector type.
+ * @tparam count_t    The number of steps.
+ *
+ * @param steps  The steps, in time order.
+ * @param offset Added to every step's time.
+ *
+ * @returns The number of failed steps.
+ */
+template <typename detector_t, size_t count_t>
+static uint32_t count_gesture_failures(const gesture_step (&steps)[count_t],
+                                       uint16_t offset) {
+    detector_t detector;
+    uint32_t failures = 0;
+    for (const gesture_step& step : steps) {
+        detector.update(step.held, step.at + offset);
+        failures += detector.tap() != step.tap ||
+                    detector.double_tap() != step.double_tap ||
+                    detector.long_press() != step.long_press;
+    }
+    return failures;
+}
+
+/**
+ * The player score button gestures, as set up in scornado.cpp: a long press
+ * takes two seconds, and both buttons held that long start a new match.
+ */
+static const uint8_t P1 = p1_score_switch::MASK;
+static const uint8_t P2 = p2_score_switch::MASK;
+static const gesture_step SCORE_GESTURES[] = {
+    /* A tap, then a double tap pressed 150ms after it. */
+    { 0, P1, 0, 0, 0 },
+    { 100, 0, P1, 0, 0 },
+    { 250, P1, 0, 0, 0 },
+    { 300, 0, 0, P1, 0 },
+
+    /* Two taps pressed 400ms apart, too far apart to be a double tap. */
+    { 1000, P1, 0, 0, 0 },
+    { 1400, 0, P1, 0, 0 },
+    { 1800, P1, 0, 0, 0 },
+    { 1850, 0, P1, 0, 0 },
+
+    /* A long press, reported once after two seconds, with no tap after. */
+    { 3000, P2, 0, 0, 0 },
+    { 4999, P2, 0, 0, 0 },
+    { 5000, P2, 0, 0, P2 },
+    { 5500, P2, 0, 0, 0 },
+    { 6000, 0, 0, 0, 0 },
+
+    /* The new match chord, timed from when the second button joins. */
+    { 7000, P1, 0, 0, 0 },
+    { 7050, P1 | P2, 0, 0, 0 },
+    { 9049, P1 | P2, 0, 0, 0 },
+    { 9050, P1 | P2, 0, 0, P1 | P2 },
+    { 9100, P2, 0, 0, 0 },
+    { 9200, 0, 0, 0, 0 },
+
+    /* A chord tap, which must not pair with a tap of one button. */
+    { 10000, P1 | P2, 0, 0, 0 },
+    { 10100, 0, P1 | P2, 0, 0 },
+    { 10200, P1, 0, 0, 0 },
+    { 10250, 0, P1, 0, 0 },
+
+    /* A tap, then a long press starting within the double tap time. */
+    { 11000, P1, 0, 0, 0 },
+    { 11100, 0, P1, 0, 0 },
+    { 11200, P1, 0, 0, 0 },
+    { 13200, P1, 0, 0, P1 },
+    { 13300, 0, 0, 0, 0 }
+};
+
+/**
+ * The undo button gestures, as set up in scornado.cpp: with a double tap time
+ * of zero every tap is reported as a tap, however quick, and a one second long
+ * press swaps ends.
+ */
+static const uint8_t UNDO = undo_switch::MASK;
+static const gesture_step UNDO_GESTURES[] = {
+    { 0, UNDO, 0, 0, 0 },
+    { 50, 0, UNDO, 0, 0 },
+    { 100, UNDO, 0, 0, 0 },
+    { 150, 0, UNDO, 0, 0 },
+    { 200, UNDO, 0, 0, 0 },
+    { 200, 0, UNDO, 0, 0 },
+    { 201, UNDO, 0, 0, 0 },
+    { 201, 0, UNDO, 0, 0 },
+    { 1000, UNDO, 0, 0, 0 },
+    { 1999, UNDO, 0, 0, 0 },
+    { 2000, UNDO, 0, 0, UNDO },
+    { 2100, 0, 0, 0, 0 },
+    { 2200, UNDO, 0, 0, 0 },
+    { 2250, 0, UNDO, 0, 0 }
+};
+
+/**
+ * Replays SCORE_GESTURES and UNDO_GESTURES through gesture detectors set up
+ * as in scornado.cpp, starting at several times including just before the
+ * 16 bit timestamps wrap, and checks that a detector cancelled while a button
+ * is held reports nothing for that hold. Writes the result to stdout.
+ *
+ * @returns True if every step gave the expected gestures.
+ */
+static bool verify_gestures() {
+    using score_detector = avr_gesture_detector<
+        2000,
+        300,
+        p1_score_switch,
+        p2_score_switch>;
+    using undo_detector = avr_gesture_detector<1000, 0, undo_switch>;
+    static const uint16_t OFFSETS[] = { 0, 0x8000, 0xFF00 };
+    uint32_t steps = 0;
+    uint32_t failures = 0;
+    for (uint16_t offset : OFFSETS) {
+        failures += count_gesture_failures<score_detector>(SCORE_GESTURES,
+                                                           offset);
+        failures += count_gesture_failures<undo_detector>(UNDO_GESTURES,
+                                                          offset);
+        steps += sizeof(SCORE_GESTURES) / sizeof(SCORE_GESTURES[0]) +
+                 sizeof(UNDO_GESTURES) / sizeof(UNDO_GESTURES[0]);
+    }
+
+    /**
+     * A tap cancelled while held, as when the press woke the scorer, must not
+     * be reported, nor pair with the tap after it.
+     */
+    score_detector detector;
+    detector.update(P1, 0);
+    detector.update(0, 100);
+    detector.update(P1, 200);
+    detector.cancel();
+    detector.update(0, 250);
+    failures += detector.tap() != 0 || detector.double_tap() != 0;
+    detector.update(P1, 300);
+    detector.update(0, 350);
+    failures += detector.tap() != P1 || detector.double_tap() != 0;
+
+    std::printf("{\"verify\":\"avr_gesture_detector\",\"steps\":%u,"
+                "\"failures\":%u}\n",
+                steps,
+                failures);
+    return failures == 0;
+}
+
+/**
+ * Stands in for avr_seven_segment_pins in a scanner, keeping the last
+ * pattern the scanner sent instead of driving segment pins.
+ */
+struct segment_recorder {
+    void display_custom(uint8_t mask) {
+        last = mask;
+    }
+
+    void clear() {
+        last = 0;
+    }
+
+    static uint8_t last;
+};
+
+uint8_t segment_recorder::last = 0;
+
+/**
+ * A scanner whose digit selection pins are the low five bits of bank B, so
+ * the lit pin tells which digit each pattern it sends is for.
+ */
+using recording_scanner = avr_seven_segment_scanner<
+    segment_recorder,
+    board_output_pin<avr_io_bank_b, 0>,
+    board_output_pin<avr_io_bank_b, 1>,
+    board_output_pin<avr_io_bank_b, 2>,
+    board_output_pin<avr_io_bank_b, 3>,
+    board_output_pin<avr_io_bank_b, 4>>;
+
+/**
+ * Reads back what a display attached to a recording_scanner shows by
+ * scanning every digit once.
+ *
+ * @tparam num_digits_t The number of digits in the display, at most five.
+ *
+ * @param scanner The scanner, with only the display attached.
+ * @param frame   Set to the pattern of each digit.
+ */
+template <uint8_t num_digits_t>
+static void read_frame(recording_scanner& scanner,
+                       uint8_t (&frame)[num_digits_t]) {
+    for (uint8_t i = 0; i < num_digits_t; ++i) {
+        scanner.refresh();
+        uint8_t digit = 0;
+        while (digit < 5 && !(PORTB & (1 << digit))) {
+            ++digit;
+        }
+        if (digit < num_digits_t) {
+            frame[digit] = segment_recorder::last;
+        }
+    }
+}
+
+/**
+ * Renders a number as avr_seven_segment_display::display_decimal() did
+ * before it stopped dividing, as the reference for verify_display_decimal().
+ *
+ * @tparam num_digits_t The number of digits in the display.
+ *
+ * @param number        The number to display.
+ * @param decimal_point The digit with the decimal point lit, or -1.
+ * @param frame         Set to the pattern of each digit.
+ */
+template <uint8_t num_digits_t>
+static void reference_decimal(uint8_t number, int8_t decimal_point,
+                              uint8_t (&frame)[num_digits_t]) {
+    for (uint8_t i = 0; i < num_digits_t; ++i) {
+        uint8_t mask;
+        if (number) {
+            mask = avr_seven_segment_digit(number % 10);
+            number /= 10;
+        } else if (i == 0 || (decimal_point >= 0 && i <= decimal_point)) {
+            mask = avr_seven_segment_digit(0);
+        } else {
+            mask = 0;
+        }
+
+        if (i == decimal_point) {
+            mask |= SEG_DP;
+        }
+
+        frame[i] = mask;
+    }
+}
+
+/**
+ * Shows every number with the decimal point on every digit, and off, on a
+ * display with some number of digits, and compares what it shows with
+ * reference_decimal(). Each is drawn once after another number, and again
+ * after display_text(), display_custom() or display_hex() has drawn over it,
+ * which must not be mistaken for the number still being shown.
+ *
+ * Must only be called once for each number of digits.
+ *
+ * @tparam num_digits_t The number of digits in the display.
+ *
+ * @param frames Incremented for every frame compared.
+ *
+ * @returns The number of frames that differed.
+ */
+template <uint8_t num_digits_t>
+static uint32_t count_decimal_failures(uint32_t& frames) {
+    static avr_seven_segment_display<num_digits_t> display;
+    static recording_scanner scanner;
+    scanner.attach(display);
+    uint32_t failures = 0;
+    for (int8_t point = -1; point <= num_digits_t; ++point) {
+        for (uint16_t number = 0; number < 256; ++number) {
+            uint8_t expected[num_digits_t];
+            reference_decimal(number, point, expected);
+            for (uint8_t overwrite = 0; overwrite < 4; ++overwrite) {
+                if (overwrite == 1) {
+                    display.display_text("8.8.8.8.8.");
+                } else if (overwrite == 2) {
+                    display.display_custom(0xFF, num_digits_t - 1);
+                } else if (overwrite == 3) {
+                    display.display_hex(0xFFFFF);
+                }
+                display.display_decimal(number, point);
+
+                uint8_t frame[num_digits_t] = {};
+                read_frame(scanner, frame);
+                for (uint8_t i = 0; i < num_digits_t; ++i) {
+                    if (frame[i] != expected[i]) {
+                        ++failures;
+                        break;
+                    }
+                }
+                ++frames;
+            }
+        }
+    }
+    return failures;
+}
+
+/**
+ * Checks avr_seven_segment_display::display_decimal() on displays of one to
+ * five digits, see count_decimal_failures(), and avr_divmod10() for every
+ * uint8_t. Writes the result to stdout.
+ *
+ * @returns True if every number was drawn as before.
+ */
+static bool verify_display_decimal() {
+    uint32_t frames = 0;
+    uint32_t failures = count_decimal_failures<1>(frames) +
+                        count_decimal_failures<2>(frames) +
+                        count_decimal_failures<3>(frames) +
+                        count_decimal_failures<4>(frames) +
+                        count_decimal_failures<5>(frames);
+    for (uint16_t number = 0; number < 256; ++number) {
+        uint8_t quotient = number;
+        uint8_t remainder = avr_divmod10(quotient);
+        failures += quotient != number / 10 || remainder != number % 10;
+    }
+
+    std::printf("{\"verify\":\"avr_seven_segment_display::display_decimal\","
+                "\"frames\":%u,\"failures\":%u}\n",
+                frames,
+                failures);
+    return failures == 0;
+}
+
+/**
+ * The firmware objects being benchmarked, set up the same way as in
+ * scornado.cpp.
+ */
+avr_button<p1_score_switch> p1_score_button;
+avr_port_debouncer<
+    game_mode_switch,
+    first_serve_switch,
+    p1_score_switch,
+    p2_score_switch> bank_c_debouncer;
+avr_edge_debouncer<
+    20,
+    game_mode_switch,
+    first_serve_switch,
+    p1_score_switch,
+    p2_score_switch> bank_c_buttons;
+avr_seven_segment_display<2> p1_score_display;
+avr_seven_segment_scanner<
+    seven_segment_pins,
+    p1_score_ones_digit,
+    p1_score_tens_digit> display_scanner;
+
+/**
+ * Entry point for the benchmarks.
+ */
+int main (int, char**) {
+    if (!verify_kernels() ||
+        !verify_pool() ||
+        !verify_undo() ||
+        !verify_telemetry() ||
+        !verify_isr_queue() ||
+        !verify_port_debouncer() ||
+        !verify_edge_debouncer() ||
+        !verify_gestures() ||
+        !verify_display_decimal()) {
+        return 1;
+    }
+
+    display_scanner.attach(p1_score_display);
+
+    bench("avr_button::check", [](uint32_t) {
+        PINC = next_random();
+        p1_score_button.check();
+    });
+
+    bench("avr_port_debouncer::sample", [](uint32_t) {
+        PINC = next_random();
+        bank_c_debouncer.sample();
+    });
+
+    bench("avr_edge_debouncer::update", [](uint32_t i) {
+        bank_c_buttons.update(next_random(), i * 4);
+    });
+
+    avr_isr_queue<avr_pin_change_event, 8> queue;
+    bench("avr_isr_queue::push+pop", [&](uint32_t i) {
+        queue.push(avr_pin_change_event { static_cast<uint16_t>(i), 0 });
+        avr_pin_change_event event;
+        queue.pop(event);
+    });
+
+    bench("avr_seven_segment_display::display_decimal", [](uint32_t i) {
+        p1_score_display.display_decimal(i % 100);
+    });
+
+    bench("avr_seven_segment_scanner::refresh", [](uint32_t) {
+        display_scanner.refresh();
+    });
+
+    table_tennis tt;
+    bench("table_tennis::p1_score", [&](uint32_t i) {
+        if (i % 3 == 2) {
+            tt.p2_score();
+        } else {
+            tt.p1_score();
+        }
+    });
+
+    bench("table_tennis::serve", [&](uint32_t i) {
+        if (tt.serve() == table_tennis::serve_player::p1) {
+            PORTC = i;
+        }
+    });
+
+    bench("table_tennis::undo", [&](uint32_t) {
+        if (next_random() < 128) {
+            tt.undo();
+        } else {
+            tt.p1_score();
+        }
+    });
+
+    /**
+     * Points are scored across many matches in batches, so each iteration
+     * accounts for one point of a batch.
+     */
+    static const uint32_t POOL_MATCHES = 100000;
+    static const uint32_t POOL_BATCH = 4096;
+    table_tennis_pool pool(POOL_MATCHES);
+    static table_tennis_pool::point_event events[POOL_BATCH];
+    for (uint32_t i = 0; i < POOL_BATCH; ++i) {
+        uint32_t match = (static_cast<uint32_t>(next_random()) << 16 |
+                          next_random() << 8 | next_random()) % POOL_MATCHES;
+        events[i] = { match, static_cast<uint8_t>(next_random() & 1) };
+    }
+    bench("table_tennis_pool::apply", [&](uint32_t i) {
+        if (i % POOL_BATCH == 0) {
+            pool.apply(events, POOL_BATCH);
+        }
+    });
+
+    /**
+     * Every kernel evaluates the same batch of games in progress.
+     */
+    static uint8_t evaluate_p1[POOL_BATCH];
+    static uint8_t evaluate_p2[POOL_BATCH];
+    static uint8_t evaluate_to_21[POOL_BATCH];
+    static uint8_t evaluate_p2_first[POOL_BATCH];
+    static uint8_t evaluate_deuce[POOL_BATCH];
+    static uint8_t evaluate_winner[POOL_BATCH];
+    static uint8_t evaluate_p2_serving[POOL_BATCH];
+    for (uint32_t i = 0; i < POOL_BATCH; ++i) {
+        evaluate_p1[i] = next_random() % 24;
+        evaluate_p2[i] = next_random() % 24;
+        evaluate_to_21[i] = next_random() & 1;
+        evaluate_p2_first[i] = next_random() & 1;
+    }
+    table_tennis_lanes evaluate_lanes = {
+        evaluate_p1,
+        evaluate_p2,
+        evaluate_to_21,
+        evaluate_p2_first,
+        evaluate_deuce,
+        evaluate_winner,
+        evaluate_p2_serving
+    };
+    static char evaluate_names[3][48];
+    for (int k = 0; k < 3; ++k) {
+        table_tennis_kernel kernel = static_cast<table_tennis_kernel>(k);
+        if (!table_tennis_kernel_supported(kernel)) {
+            continue;
+        }
+        std::snprintf(evaluate_names[k], sizeof(evaluate_names[k]),
+                      "table_tennis_evaluate::%s", KERNEL_NAMES[k]);
+        bench(evaluate_names[k], [&](uint32_t i) {
+            if (i % POOL_BATCH == 0) {
+                table_tennis_evaluate(kernel, evaluate_lanes, POOL_BATCH);
+            }
+        });
+    }
+
+    telemetry_encoder telemetry(0);
+    uint8_t frame[TELEMETRY_FRAME_SIZE];
+    bench("telemetry_encoder::encode", [&](uint32_t) {
+        telemetry.encode(frame, telemetry_event::point, tt, false);
+    });
+
+    bench("telemetry_decode", [&](uint32_t) {
+        uint8_t received[TELEMETRY_FRAME_SIZE];
+        telemetry.encode(received, telemetry_event::point, tt, false);
+        telemetry_frame decoded;
+        if (telemetry_decode(received, sizeof(received) - 1, decoded)) {
+            PORTC = decoded.p1_score();
+        }
+    });
+
+    return 0;
+}
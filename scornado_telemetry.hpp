@@ -0,0 +1,338 @@
+/**
+ * The scornado telemetry wire format, which reports every change of the game
+ * over a byte stream, e.g. the serial port, so that something else, such as a
+ * venue scoreboard, can follow the match. Many tables can share one link, and
+ * this header builds both on the atmega328p, which encodes frames, and on the
+ * receiving machine, which decodes them.
+ *
+ * Each change is sent as one frame. Before framing a frame is
+ * TELEMETRY_PAYLOAD_SIZE bytes:
+ *
+ *     0    Format version (high nibble) and telemetry_event (low nibble)
+ *     1    Table number, to tell tables sharing a link apart
+ *     2    Sequence number, one more than the table's previous frame modulo
+ *          256, so a receiver can tell that frames were lost
+ *     3    Player one's score
+ *     4    Player two's score
+ *     5    Games won by player one
+ *     6    Games won by player two
+ *     7    Flags, see TELEMETRY_FLAG_*
+ *     8-9  CRC-16/CCITT-FALSE of bytes 0-7, high byte first
+ *
+ * The payload is then COBS encoded, which removes every zero byte at the cost
+ * of one extra byte, and followed by a zero byte, so frames are always
+ * TELEMETRY_FRAME_SIZE bytes on the wire and a receiver finds the next frame
+ * by waiting for a zero. Every frame carries the whole game, so a receiver
+ * that misses one is back in step with the next.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#ifndef __SCORNADO_TELEMETRY_HPP__
+#define __SCORNADO_TELEMETRY_HPP__
+
+#include <stdint.h>
+
+#include "table_tennis.hpp"
+
+/**
+ * What changed the game.
+ */
+enum class telemetry_event : uint8_t {
+    /**
+     * A player scored a point without winning the game.
+     */
+    point = 1,
+
+    /**
+     * A player scored the point that won the game.
+     */
+    game_won = 2,
+
+    /**
+     * The last point was undone.
+     */
+    undo = 3,
+
+    /**
+     * The game mode changed.
+     */
+    game_mode = 4,
+
+    /**
+     * The first server changed.
+     */
+    first_serve = 5,
+
+    /**
+     * A new match started.
+     */
+    new_match = 6,
+
+    /**
+     * The players swapped ends.
+     */
+    ends_swapped = 7
+};
+
+/**
+ * The version of the format described above. Receivers must ignore frames of
+ * other versions.
+ */
+static const uint8_t TELEMETRY_VERSION = 1;
+
+/**
+ * The size of a frame before framing, in bytes, including the CRC.
+ */
+static const uint8_t TELEMETRY_PAYLOAD_SIZE = 10;
+
+/**
+ * The size of a frame on the wire, in bytes: the COBS encoded payload and the
+ * zero byte that ends it.
+ */
+static const uint8_t TELEMETRY_FRAME_SIZE = TELEMETRY_PAYLOAD_SIZE + 2;
+
+/**
+ * Bits of the frame's flags byte.
+ */
+static const uint8_t TELEMETRY_FLAG_TO_21 = 0x01;
+static const uint8_t TELEMETRY_FLAG_P2_FIRST_SERVE = 0x02;
+static const uint8_t TELEMETRY_FLAG_P2_SERVING = 0x04;
+static const uint8_t TELEMETRY_FLAG_ENDS_SWAPPED = 0x08;
+
+/**
+ * Computes the CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF) of
+ * a block of bytes. This is done a bit at a time rather than with a table to
+ * save flash, which is fast enough for a few bytes per frame.
+ *
+ * @param data The bytes.
+ * @param size The number of bytes.
+ *
+ * @returns The CRC.
+ */
+inline uint16_t telemetry_crc(const uint8_t* data, uint8_t size) {
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < size; ++i) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * Builds telemetry frames for one table, numbering them in sequence. Frames
+ * are built directly in a buffer supplied by the caller, so nothing is
+ * allocated.
+ */
+struct telemetry_encoder {
+    /**
+     * Creates an encoder.
+     *
+     * @param table The number of the table the frames are for.
+     */
+    explicit telemetry_encoder(uint8_t table):
+        _table(table) {
+    }
+
+    /**
+     * Builds the frame for a change of the game.
+     *
+     * @tparam table_tennis_t The type of the game, a basic_table_tennis.
+     *
+     * @param frame        Set to the frame, ready to send.
+     * @param event        What changed the game.
+     * @param tt           The game after the change.
+     * @param ends_swapped Whether the players have swapped ends.
+     */
+    template <typename table_tennis_t>
+    void encode(uint8_t (&frame)[TELEMETRY_FRAME_SIZE],
+                telemetry_event event,
+                const table_tennis_t& tt,
+                bool ends_swapped) {
+        uint8_t flags = 0;
+        if (tt.get_game_mode() == table_tennis_base::game_mode::to_21) {
+            flags |= TELEMETRY_FLAG_TO_21;
+        }
+        if (tt.get_first_serve() == table_tennis_base::serve_player::p2) {
+            flags |= TELEMETRY_FLAG_P2_FIRST_SERVE;
+        }
+        if (tt.serve() == table_tennis_base::serve_player::p2) {
+            flags |= TELEMETRY_FLAG_P2_SERVING;
+        }
+        if (ends_swapped) {
+            flags |= TELEMETRY_FLAG_ENDS_SWAPPED;
+        }
+
+        /**
+         * The payload is built one byte along, where COBS leaves it.
+         */
+        uint8_t* payload = &frame[1];
+        payload[0] = (TELEMETRY_VERSION << 4) | static_cast<uint8_t>(event);
+        payload[1] = _table;
+        payload[2] = _sequence++;
+        payload[3] = tt.get_p1_score();
+        payload[4] = tt.get_p2_score();
+        payload[5] = tt.get_p1_games_won();
+        payload[6] = tt.get_p2_games_won();
+        payload[7] = flags;
+        uint16_t crc = telemetry_crc(payload, TELEMETRY_PAYLOAD_SIZE - 2);
+        payload[8] = crc >> 8;
+        payload[9] = crc;
+
+        /**
+         * COBS encode in place. Each zero byte is replaced by the distance to
+         * the next zero byte, or to the end, and the first byte of the frame
+         * holds the distance to the first one. This short a payload never
+         * needs more than the one extra byte.
+         */
+        uint8_t code_at = 0;
+        for (uint8_t i = 1; i <= TELEMETRY_PAYLOAD_SIZE; ++i) {
+            if (frame[i] == 0) {
+                frame[code_at] = i - code_at;
+                code_at = i;
+            }
+        }
+        frame[code_at] = TELEMETRY_PAYLOAD_SIZE + 1 - code_at;
+        frame[TELEMETRY_FRAME_SIZE - 1] = 0;
+    }
+
+private:
+    /**
+     * The number of the table.
+     */
+    uint8_t _table;
+
+    /**
+     * The sequence number of the next frame.
+     */
+    uint8_t _sequence = 0;
+};
+
+/**
+ * A decoded telemetry frame. The fields are read straight out of the receive
+ * buffer the frame was decoded in, so nothing is copied. The view is only
+ * valid while that buffer is.
+ */
+struct telemetry_frame {
+    /**
+     * Gets what changed the game.
+     */
+    telemetry_event event() const {
+        return static_cast<telemetry_event>(_payload[0] & 0x0F);
+    }
+
+    /**
+     * Gets the number of the table.
+     */
+    uint8_t table() const {
+        return _payload[1];
+    }
+
+    /**
+     * Gets the sequence number.
+     */
+    uint8_t sequence() const {
+        return _payload[2];
+    }
+
+    /**
+     * Gets player one's score.
+     */
+    uint8_t p1_score() const {
+        return _payload[3];
+    }
+
+    /**
+     * Gets player two's score.
+     */
+    uint8_t p2_score() const {
+        return _payload[4];
+    }
+
+    /**
+     * Gets the games won by player one.
+     */
+    uint8_t p1_games_won() const {
+        return _payload[5];
+    }
+
+    /**
+     * Gets the games won by player two.
+     */
+    uint8_t p2_games_won() const {
+        return _payload[6];
+    }
+
+    /**
+     * Gets the flags, see TELEMETRY_FLAG_*.
+     */
+    uint8_t flags() const {
+        return _payload[7];
+    }
+
+private:
+    friend bool telemetry_decode(uint8_t*, uint16_t, telemetry_frame&);
+
+    /**
+     * The decoded payload, inside the receive buffer.
+     */
+    const uint8_t* _payload = nullptr;
+};
+
+/**
+ * Decodes a telemetry frame in place in a receive buffer.
+ *
+ * @param data  The frame as received, without the zero byte that ended it. It
+ *              is overwritten by the decoded payload.
+ * @param size  The number of bytes in the frame.
+ * @param frame Set to a view of the frame if it is valid.
+ *
+ * @returns True if the frame was decoded, false if it is the wrong size, is
+ *          not valid COBS, fails its CRC, is of another version or has no
+ *          telemetry_event.
+ */
+inline bool telemetry_decode(uint8_t* data,
+                             uint16_t size,
+                             telemetry_frame& frame) {
+    if (size != TELEMETRY_FRAME_SIZE - 1) {
+        return false;
+    }
+
+    /**
+     * Undo the COBS encoding, moving the payload one byte down. Each code
+     * byte gives the distance to the next, where a zero goes back.
+     */
+    uint8_t next_code = data[0];
+    for (uint8_t i = 1; i < size; ++i) {
+        if (data[i] == 0 || next_code == 0) {
+            return false;
+        }
+        if (i == next_code) {
+            next_code = i + data[i];
+            data[i - 1] = 0;
+        } else {
+            data[i - 1] = data[i];
+        }
+    }
+    if (next_code != size) {
+        return false;
+    }
+
+    uint16_t crc = telemetry_crc(data, TELEMETRY_PAYLOAD_SIZE - 2);
+    uint8_t event = data[0] & 0x0F;
+    if (data[8] != static_cast<uint8_t>(crc >> 8) ||
+        data[9] != static_cast<uint8_t>(crc) ||
+        (data[0] >> 4) != TELEMETRY_VERSION ||
+        event < static_cast<uint8_t>(telemetry_event::point) ||
+        event > static_cast<uint8_t>(telemetry_event::ends_swapped)) {
+        return false;
+    }
+
+    frame._payload = data;
+    return true;
+}
+
+#endif /* __SCORNADO_TELEMETRY_HPP__ */
@@ -8,12 +8,12 @@
 #ifndef __TABLE_TENNIS_HPP__
 #define __TABLE_TENNIS_HPP__
 
+#include <stdint.h>
+
 /**
- * Encapsulates the data and logic for a game of table tennis. This class
- * contains just game data and logic and does not care about how the game is
- * controlled or displayed.
+ * Types shared by every table tennis game, regardless of its undo depth.
  */
-struct table_tennis {
+struct table_tennis_base {
     /**
      * Used to select whether games should be played to eleven or twenty one
      * points. A simple bool could be used, but makes the code less readable.
@@ -45,6 +45,45 @@ struct table_tennis {
          */
         p2
     };
+};
+
+/**
+ * Encapsulates the data and logic for a game of table tennis. This class
+ * contains just game data and logic and does not care about how the game is
+ * controlled or displayed.
+ *
+ * Rather than saving a copy of the game state for every point, the undo history
+ * is a log with one bit per point recording which player won it, plus a copy of
+ * the game state (a checkpoint) every so many points and whenever the game mode
+ * or first server changes. Undoing a point restores the latest checkpoint
+ * before it and replays the points logged since.
+ *
+ * @tparam max_undo_t            The number of points that can be undone, a
+ *                               power of two no larger than 32768.
+ * @tparam checkpoint_interval_t The most points that are logged between
+ *                               checkpoints, which bounds the number of points
+ *                               replayed by an undo. There can be at most 126
+ *                               intervals in the undo depth.
+ */
+template <uint16_t max_undo_t, uint16_t checkpoint_interval_t>
+struct basic_table_tennis : table_tennis_base {
+    static_assert(max_undo_t >= 8 && max_undo_t <= 32768 &&
+                  (max_undo_t & (max_undo_t - 1)) == 0,
+                  "The undo depth must be a power of two from 8 to 32768.");
+    static_assert(checkpoint_interval_t > 0 &&
+                  checkpoint_interval_t <= max_undo_t,
+                  "The checkpoint interval must be from 1 to the undo depth.");
+    static_assert(max_undo_t / checkpoint_interval_t + 2 <= 128,
+                  "The undo depth must be at most 126 checkpoint intervals.");
+
+    /**
+     * Creates a new match, with player 1 serving first in an eleven point
+     * game.
+     */
+    basic_table_tennis() {
+        _checkpoints[0].state = _state;
+        _checkpoints[0].point = 0;
+    }
 
     /**
      * Get how many games player one has won.
@@ -64,6 +103,24 @@ struct table_tennis {
         return _state.p2_games_won;
     }
 
+    /**
+     * Gets whether games are played to eleven or twenty one points.
+     *
+     * @returns The game mode.
+     */
+    game_mode get_game_mode() const {
+        return _state.mode();
+    }
+
+    /**
+     * Gets which player served first in the current game.
+     *
+     * @returns The player who served first.
+     */
+    serve_player get_first_serve() const {
+        return _state.first_serve();
+    }
+
     /**
      * Gets how many points player one has scored in the current game.
      *
@@ -84,6 +141,29 @@ struct table_tennis {
         return _state.p2_score;
     }
 
+    /**
+     * Gets a number that changes every time the score, games won, serve or game
+     * mode changes, so callers can skip redrawing an unchanged game. It wraps
+     * after 256 changes, so it must be checked more often than that.
+     *
+     * @returns The version of the game state.
+     */
+    uint8_t version() const {
+        return _version;
+    }
+
+    /**
+     * Determines whether or not the deuce condition has been reached. For
+     * eleven point games this happens when the score reaches 10/10. For
+     * twenty one point games this happens when the score reaches 20/20.
+     *
+     * @returns True if the deuce condition has been reached, false otherwise.
+     */
+    bool deuce() const {
+        int deuce_points = _state.mode() == game_mode::to_11 ? 10 : 20;
+        return get_p1_score() >= deuce_points && get_p2_score() >= deuce_points;
+    }
+
     /**
      * Determine which player is currently serving.
      *
@@ -97,14 +177,14 @@ struct table_tennis {
          */
         int serve_interval = deuce()
                              ? 1
-                             : (_state.mode == game_mode::to_11 ? 2 : 5);
+                             : (_state.mode() == game_mode::to_11 ? 2 : 5);
         int num_intervals = (get_p1_score() + get_p2_score()) / serve_interval;
         if (num_intervals % 2 == 0) {
-           return _state.first_serve == serve_player::p1
+           return _state.first_serve() == serve_player::p1
                   ? serve_player::p1
                   : serve_player::p2;
         } else {
-           return _state.first_serve == serve_player::p1
+           return _state.first_serve() == serve_player::p1
                   ? serve_player::p2
                   : serve_player::p1;
         }
@@ -115,9 +195,7 @@ struct table_tennis {
      * necessary game state adjustments are made automatically.
      */
     void p1_score() {
-        save_state();
-        _state.p1_score++;
-        check_for_win();
+        log_point(false);
     }
 
     /**
@@ -125,21 +203,57 @@ struct table_tennis {
      * necessary game state adjustments are made automatically.
      */
     void p2_score() {
-        save_state();
-        _state.p2_score++;
-        check_for_win();
+        log_point(true);
     }
 
     /**
-     * Undoes the last point scored in the history. If there are no game states
-     * in the history then this function does nothing.
+     * Undoes the last point scored in the history. If there are no points in
+     * the history then this function does nothing. Any game mode or first
+     * server change made since that point was scored is undone as well.
      */
     void undo() {
-        if (_history_index >= 0) {
-            _state = _history[_history_index--];
+        if (_log_count == 0) {
+            return;
+        }
+        --_log_end;
+        --_log_count;
+        ++_version;
+
+        /**
+         * Discard the checkpoints taken after the undone point. The oldest
+         * checkpoint is always at the start of the log so at least one is
+         * kept.
+         */
+        while (_checkpoint_count > 1 &&
+               offset(last_checkpoint().point) > _log_count) {
+            --_checkpoint_count;
+        }
+
+        _state = last_checkpoint().state;
+        for (uint16_t point = last_checkpoint().point;
+             point != _log_end;
+             ++point) {
+            apply_point(logged_point(point));
         }
     }
 
+    /**
+     * Starts a new match, clearing the scores, the games won and the undo
+     * history. The game mode and the first server are kept.
+     */
+    void new_match() {
+        game_state state;
+        state.set_mode(_state.mode());
+        state.set_first_serve(_state.first_serve());
+        _state = state;
+        _log_count = 0;
+        _checkpoint_first = 0;
+        _checkpoint_count = 1;
+        _checkpoints[0].state = _state;
+        _checkpoints[0].point = _log_end;
+        ++_version;
+    }
+
     /**
      * Sets the game mode to eleven or twenty one point mode. This can only be
      * changed between matches. If this function is called in the middle of a
@@ -148,8 +262,11 @@ struct table_tennis {
      * @param mode The desired game mode.
      */
     void set_game_mode(game_mode mode) {
-        if (get_p1_score() == 0 && get_p2_score() == 0) {
-            _state.mode = mode;
+        if (get_p1_score() == 0 && get_p2_score() == 0 &&
+            _state.mode() != mode) {
+            _state.set_mode(mode);
+            save_checkpoint();
+            ++_version;
         }
     }
 
@@ -161,8 +278,11 @@ struct table_tennis {
      * @param serve_player Which player should serve first.
      */
     void set_first_serve(serve_player first_serve_player) {
-        if (get_p1_score() == 0 && get_p2_score() == 0) {
-            _state.first_serve = first_serve_player;
+        if (get_p1_score() == 0 && get_p2_score() == 0 &&
+            _state.first_serve() != first_serve_player) {
+            _state.set_first_serve(first_serve_player);
+            save_checkpoint();
+            ++_version;
         }
     }
 
@@ -170,44 +290,90 @@ private:
     /**
      * Helper structure storing all relevant information for a table tennis
      * match. This is used so it's easy to copy and store the entire game state
-     * so we can maintain an array of game states to enable the undo function.
+     * so we can keep checkpoints of it to enable the undo function. The fields
+     * are packed into four bytes to keep the checkpoints small.
      */
     struct game_state {
         /**
-         *  How many games player 1 has won.
+         * Creates the state of a new match, with player 1 serving first in an
+         * eleven point game.
          */
-        int p1_games_won = 0;
+        game_state():
+            p1_score(0),
+            p2_score(0),
+            p1_games_won(0),
+            to_21(0),
+            p2_games_won(0),
+            p2_serves_first(0) {
+        }
 
         /**
-         * How many points player 1 has scored in the current round.
+         * Gets whether games should be played to eleven or twenty one points.
+         */
+        game_mode mode() const {
+            return to_21 ? game_mode::to_21 : game_mode::to_11;
+        }
+
+        /**
+         * Sets whether games should be played to eleven or twenty one points.
+         */
+        void set_mode(game_mode mode) {
+            to_21 = mode == game_mode::to_21;
+        }
+
+        /**
+         * Gets which player served first in the game.
          */
-        int p1_score = 0;
+        serve_player first_serve() const {
+            return p2_serves_first ? serve_player::p2 : serve_player::p1;
+        }
+
+        /**
+         * Sets which player served first in the game.
+         */
+        void set_first_serve(serve_player first_serve) {
+            p2_serves_first = first_serve == serve_player::p2;
+        }
 
         /**
-         * How many games player 2 has won.
+         * How many points player 1 has scored in the current round.
          */
-        int p2_games_won = 0;
+        uint8_t p1_score;
 
         /**
          * How many points player 2 has scored in the current round.
          */
-        int p2_score = 0;
+        uint8_t p2_score;
+
+        /**
+         *  How many games player 1 has won, up to MAX_GAMES_WON.
+         */
+        uint8_t p1_games_won : 7;
+
+        /**
+         * Set if games should be played to twenty one points, clear if games
+         * should be played to eleven points.
+         */
+        uint8_t to_21 : 1;
 
         /**
-         * Which player served first in the game.
+         * How many games player 2 has won, up to MAX_GAMES_WON.
          */
-        serve_player first_serve = serve_player::p1;
+        uint8_t p2_games_won : 7;
 
         /**
-         * Whether games should be played to eleven or twenty one points.
+         * Set if player 2 served first in the game, clear if player 1 did.
          */
-        game_mode mode = game_mode::to_11;
+        uint8_t p2_serves_first : 1;
     };
 
+    static_assert(sizeof(game_state) == 4,
+                  "The game state should pack into four bytes.");
+
     /**
-     * Maximum number of undo levels.
+     * The most games a player can be recorded as having won.
      */
-    static const int MAX_UNDO = 32;
+    static const int MAX_GAMES_WON = 127;
 
     /**
      *  The current game state.
@@ -215,45 +381,177 @@ private:
     game_state _state;
 
     /**
-     * A history of all previous game states, used to enable the undo
-     * feature.
+     * Incremented on every change to the game state, see version().
+     */
+    uint8_t _version = 0;
+
+    /**
+     * A copy of the game state as it was after a particular point in the log.
      */
-    game_state _history[MAX_UNDO];
+    struct checkpoint {
+        /**
+         * The game state.
+         */
+        game_state state;
+
+        /**
+         * The number of points logged, modulo 65536, before the state was
+         * copied.
+         */
+        uint16_t point;
+    };
 
     /**
-     * The current location in the history index of the latest valid game
-     * state.
+     * The most checkpoints needed: one at the start of the log, one per
+     * interval, and one more so a new checkpoint can be taken before the
+     * oldest is discarded. At most 128, so a checkpoint index plus a count
+     * fits in a byte.
      */
-    int _history_index = -1;
+    static const uint8_t MAX_CHECKPOINTS = max_undo_t / checkpoint_interval_t
+                                           + 2;
 
     /**
-     * Saves the current game state to the history array. If the history array
-     * is full then the oldest game state is discarded.
+     * Which player won each logged point, one bit per point, set for player 2.
+     * This is a circular buffer indexed by point number.
      */
-    void save_state() {
-        /**
-         * The history array is full. Copy all of the state objects back one
-         * index to make room for the new state.
-         */
-        if (_history_index == MAX_UNDO - 1) {
-            for (int i = 0; i < MAX_UNDO - 1; ++i) {
-                _history[i] = _history[i + 1];
+    uint8_t _log[max_undo_t / 8] = {};
+
+    /**
+     * The number of points ever logged, modulo 65536, less any undone.
+     */
+    uint16_t _log_end = 0;
+
+    /**
+     * The number of points in the log.
+     */
+    uint16_t _log_count = 0;
+
+    /**
+     * Checkpoints in order, as a circular buffer. The oldest checkpoint is
+     * always at the start of the log.
+     */
+    checkpoint _checkpoints[MAX_CHECKPOINTS];
+
+    /**
+     * The index of the oldest checkpoint.
+     */
+    uint8_t _checkpoint_first = 0;
+
+    /**
+     * The number of checkpoints.
+     */
+    uint8_t _checkpoint_count = 1;
+
+    /**
+     * Gets the position of a point relative to the start of the log.
+     *
+     * @param point The number of the point.
+     *
+     * @returns The number of points logged before it.
+     */
+    uint16_t offset(uint16_t point) const {
+        return point - (_log_end - _log_count);
+    }
+
+    /**
+     * Gets which player won a logged point.
+     *
+     * @param point The number of the point.
+     *
+     * @returns True if player two won the point, false if player one did.
+     */
+    bool logged_point(uint16_t point) const {
+        uint16_t index = point & (max_undo_t - 1);
+        return _log[index >> 3] & (1 << (index & 7));
+    }
+
+    /**
+     * Gets the most recent checkpoint.
+     */
+    checkpoint& last_checkpoint() {
+        uint8_t index = _checkpoint_first + _checkpoint_count - 1;
+        return _checkpoints[index < MAX_CHECKPOINTS
+                            ? index
+                            : index - MAX_CHECKPOINTS];
+    }
+
+    /**
+     * Discards the oldest checkpoint along with every point logged before the
+     * next checkpoint. There must be at least two checkpoints.
+     */
+    void discard_oldest() {
+        if (++_checkpoint_first == MAX_CHECKPOINTS) {
+            _checkpoint_first = 0;
+        }
+        --_checkpoint_count;
+        _log_count = _log_end - _checkpoints[_checkpoint_first].point;
+    }
+
+    /**
+     * Saves the current game state as a checkpoint at the end of the log. If a
+     * checkpoint was already taken there it is replaced.
+     */
+    void save_checkpoint() {
+        if (last_checkpoint().point != _log_end) {
+            if (_checkpoint_count == MAX_CHECKPOINTS) {
+                discard_oldest();
             }
-            --_history_index;
+            ++_checkpoint_count;
+            last_checkpoint().point = _log_end;
         }
-        _history[++_history_index] = _state;
+        last_checkpoint().state = _state;
     }
 
     /**
-     * Determines whether or not the deuce condition has been reached. For
-     * eleven point games this happens when the score reaches 10/10. For
-     * twenty one point games this happens when the score reaches 20/20.
+     * Logs a point and updates the game state. If the log is full then the
+     * oldest points are discarded.
      *
-     * @returns True if the deuce condition has been reached, false otherwise.
+     * @param p2 True if player two won the point, false if player one did.
      */
-    bool deuce() const {
-        int deuce_points = _state.mode == game_mode::to_11 ? 10 : 20;
-        return get_p1_score() >= deuce_points && get_p2_score() >= deuce_points;
+    void log_point(bool p2) {
+        if (static_cast<uint16_t>(_log_end - last_checkpoint().point) >=
+            checkpoint_interval_t) {
+            save_checkpoint();
+        }
+        if (_log_count == max_undo_t) {
+            discard_oldest();
+        }
+
+        uint16_t index = _log_end & (max_undo_t - 1);
+        if (p2) {
+            _log[index >> 3] |= 1 << (index & 7);
+        } else {
+            _log[index >> 3] &= ~(1 << (index & 7));
+        }
+        ++_log_end;
+        ++_log_count;
+        ++_version;
+
+        apply_point(p2);
+    }
+
+    /**
+     * Adds a point to a player's score. If that player wins then the necessary
+     * game state adjustments are made automatically. Once both players are a
+     * point past deuce a point is taken off each, which keeps the scores from
+     * growing without limit in a long deuce and changes neither who is ahead
+     * nor who serves.
+     *
+     * @param p2 True if player two won the point, false if player one did.
+     */
+    void apply_point(bool p2) {
+        if (p2) {
+            _state.p2_score++;
+        } else {
+            _state.p1_score++;
+        }
+
+        int fold_points = _state.mode() == game_mode::to_11 ? 11 : 21;
+        if (get_p1_score() >= fold_points && get_p2_score() >= fold_points) {
+            _state.p1_score--;
+            _state.p2_score--;
+        }
+        check_for_win();
     }
 
     /**
@@ -261,34 +559,46 @@ private:
      * been won then this function does the necessary updates to the game state.
      */
     void check_for_win() {
+        bool p1_won;
+        bool p2_won;
+
         /**
          * In deuce the game is won if one player has scored two points more
          * than the other player.
          */
         if (deuce()) {
-            if (get_p1_score() >= get_p2_score() + 2) {
-                _state.p1_games_won++;
-                _state.p1_score = _state.p2_score = 0;
-            } else if (get_p2_score() >= get_p1_score() + 2) {
-                _state.p2_games_won++;
-                _state.p1_score = _state.p2_score = 0;
-            }
+            p1_won = get_p1_score() >= get_p2_score() + 2;
+            p2_won = get_p2_score() >= get_p1_score() + 2;
 
         /**
          * In non-deuce state the game is won if one player has reached eleven
          * or twenty one points depending on the game mode.
          */
         } else {
-            int win = _state.mode == game_mode::to_11 ? 11 : 21;
-            if (get_p1_score() >= win) {
+            int win = _state.mode() == game_mode::to_11 ? 11 : 21;
+            p1_won = get_p1_score() >= win;
+            p2_won = !p1_won && get_p2_score() >= win;
+        }
+
+        if (p1_won) {
+            if (_state.p1_games_won < MAX_GAMES_WON) {
                 _state.p1_games_won++;
-                _state.p1_score = _state.p2_score = 0;
-            } else if (get_p2_score() >= win) {
+            }
+            _state.p1_score = _state.p2_score = 0;
+        } else if (p2_won) {
+            if (_state.p2_games_won < MAX_GAMES_WON) {
                 _state.p2_games_won++;
-                _state.p1_score = _state.p2_score = 0;
             }
+            _state.p1_score = _state.p2_score = 0;
         }
     }
 };
 
+/**
+ * A table tennis game that can undo up to 256 points using under 80 bytes of
+ * history. Once the log is full the oldest points are dropped a whole 64 point
+ * checkpoint interval at a time, so only the last 192 are sure to be kept.
+ */
+using table_tennis = basic_table_tennis<256, 64>;
+
 #endif /* __TABLE_TENNIS_HPP__ */
@@ -0,0 +1,307 @@
+/**
+ * Many games of table tennis scored together, for replaying and simulating
+ * matches in bulk on a host machine.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#ifndef __TABLE_TENNIS_POOL_HPP__
+#define __TABLE_TENNIS_POOL_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "table_tennis.hpp"
+#include "table_tennis_simd.hpp"
+
+/**
+ * Holds many matches and scores batches of points across them. Each match
+ * follows the same rules and gives the same scores, games won and serve as a
+ * table_tennis, but there is no undo history.
+ *
+ * Rather than an array of table_tennis objects, each field of every match is
+ * kept in its own array, so scoring a point only touches the bytes it needs
+ * and the win and deuce checks are done without branching on the score.
+ */
+struct table_tennis_pool : table_tennis_base {
+    /**
+     * A point scored in one of the matches.
+     */
+    struct point_event {
+        /**
+         * The index of the match.
+         */
+        uint32_t match;
+
+        /**
+         * Set if player two won the point, clear if player one did.
+         */
+        uint8_t p2;
+    };
+
+    /**
+     * Creates a pool of new matches, each with player 1 serving first in an
+     * eleven point game.
+     *
+     * @param size The number of matches.
+     */
+    explicit table_tennis_pool(uint32_t size):
+        _p1_score(size),
+        _p2_score(size),
+        _p1_games_won(size),
+        _p2_games_won(size),
+        _to_21(size),
+        _p2_serves_first(size) {
+    }
+
+    /**
+     * Gets the number of matches.
+     *
+     * @returns The number of matches.
+     */
+    uint32_t size() const {
+        return static_cast<uint32_t>(_p1_score.size());
+    }
+
+    /**
+     * Get how many games player one has won in a match.
+     *
+     * @param match The index of the match.
+     *
+     * @returns The number of games player one has won.
+     */
+    int get_p1_games_won(uint32_t match) const {
+        return _p1_games_won[match];
+    }
+
+    /**
+     * Get how many games player two has won in a match.
+     *
+     * @param match The index of the match.
+     *
+     * @returns The number of games player two has won.
+     */
+    int get_p2_games_won(uint32_t match) const {
+        return _p2_games_won[match];
+    }
+
+    /**
+     * Gets whether a match's games are played to eleven or twenty one points.
+     *
+     * @param match The index of the match.
+     *
+     * @returns The game mode.
+     */
+    game_mode get_game_mode(uint32_t match) const {
+        return _to_21[match] ? game_mode::to_21 : game_mode::to_11;
+    }
+
+    /**
+     * Gets which player served first in a match's current game.
+     *
+     * @param match The index of the match.
+     *
+     * @returns The player who served first.
+     */
+    serve_player get_first_serve(uint32_t match) const {
+        return _p2_serves_first[match] ? serve_player::p2 : serve_player::p1;
+    }
+
+    /**
+     * Gets how many points player one has scored in a match's current game.
+     *
+     * @param match The index of the match.
+     *
+     * @returns The number of points player one has scored.
+     */
+    int get_p1_score(uint32_t match) const {
+        return _p1_score[match];
+    }
+
+    /**
+     * Gets how many points player two has scored in a match's current game.
+     *
+     * @param match The index of the match.
+     *
+     * @returns The number of points player two has scored.
+     */
+    int get_p2_score(uint32_t match) const {
+        return _p2_score[match];
+    }
+
+    /**
+     * Determine which player is serving in a match, as table_tennis::serve()
+     * does.
+     *
+     * @param match The index of the match.
+     *
+     * @returns Which player is serving.
+     */
+    serve_player serve(uint32_t match) const {
+        int p1 = _p1_score[match];
+        int p2 = _p2_score[match];
+        bool to_21 = _to_21[match];
+        int deuce_points = to_21 ? 20 : 10;
+        int serve_interval = p1 >= deuce_points && p2 >= deuce_points
+                             ? 1
+                             : (to_21 ? 5 : 2);
+        bool p2_serves = ((p1 + p2) / serve_interval) % 2 != 0;
+        return p2_serves != static_cast<bool>(_p2_serves_first[match])
+               ? serve_player::p2
+               : serve_player::p1;
+    }
+
+    /**
+     * Determines for every match whether it is in deuce and which player is
+     * serving, many matches at a time with the fastest SIMD instructions this
+     * machine has, see table_tennis_evaluate().
+     *
+     * @param deuce      Set to 1 for each match in deuce, 0 otherwise.
+     * @param p2_serving Set to 1 for each match where player two is serving,
+     *                   0 where player one is.
+     * @param winner     Scratch space. Matches are never left in a won game,
+     *                   so it is set to 0 for every match.
+     */
+    void evaluate(uint8_t* deuce, uint8_t* p2_serving, uint8_t* winner) const {
+        table_tennis_lanes lanes = {
+            _p1_score.data(),
+            _p2_score.data(),
+            _to_21.data(),
+            _p2_serves_first.data(),
+            deuce,
+            winner,
+            p2_serving
+        };
+        table_tennis_evaluate(lanes, size());
+    }
+
+    /**
+     * Adds a point to player one's score in a match.
+     *
+     * @param match The index of the match.
+     */
+    void p1_score(uint32_t match) {
+        apply_point(match, false);
+    }
+
+    /**
+     * Adds a point to player two's score in a match.
+     *
+     * @param match The index of the match.
+     */
+    void p2_score(uint32_t match) {
+        apply_point(match, true);
+    }
+
+    /**
+     * Scores a batch of points, in order.
+     *
+     * @param events The points.
+     * @param count  The number of points.
+     */
+    void apply(const point_event* events, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            apply_point(events[i].match, events[i].p2);
+        }
+    }
+
+    /**
+     * Sets a match's game mode. As with table_tennis, nothing is done in the
+     * middle of a game.
+     *
+     * @param match The index of the match.
+     * @param mode  The desired game mode.
+     */
+    void set_game_mode(uint32_t match, game_mode mode) {
+        if (_p1_score[match] == 0 && _p2_score[match] == 0) {
+            _to_21[match] = mode == game_mode::to_21;
+        }
+    }
+
+    /**
+     * Sets which player serves first in a match. As with table_tennis, nothing
+     * is done in the middle of a game.
+     *
+     * @param match              The index of the match.
+     * @param first_serve_player Which player should serve first.
+     */
+    void set_first_serve(uint32_t match, serve_player first_serve_player) {
+        if (_p1_score[match] == 0 && _p2_score[match] == 0) {
+            _p2_serves_first[match] = first_serve_player == serve_player::p2;
+        }
+    }
+
+    /**
+     * Starts a new match, clearing its scores and games won. The game mode and
+     * the first server are kept.
+     *
+     * @param match The index of the match.
+     */
+    void new_match(uint32_t match) {
+        _p1_score[match] = 0;
+        _p2_score[match] = 0;
+        _p1_games_won[match] = 0;
+        _p2_games_won[match] = 0;
+    }
+
+private:
+    /**
+     * The most games a player can be recorded as having won, as in
+     * basic_table_tennis.
+     */
+    static const uint8_t MAX_GAMES_WON = 127;
+
+    /**
+     * Adds a point to a player's score in a match, and if that wins the game
+     * counts it and starts the next game. This makes the same decisions as
+     * basic_table_tennis::apply_point(), but works out every case and picks
+     * the answer with masks so the compiler has no branches to mispredict.
+     *
+     * @param match The index of the match.
+     * @param p2    True if player two won the point, false if player one did.
+     */
+    void apply_point(uint32_t match, bool p2) {
+        uint8_t p1_score = _p1_score[match] + !p2;
+        uint8_t p2_score = _p2_score[match] + p2;
+        int to_21 = _to_21[match];
+        int deuce_points = 10 + 10 * to_21;
+        int win_points = deuce_points + 1;
+
+        uint8_t fold = (p1_score >= win_points) & (p2_score >= win_points);
+        p1_score -= fold;
+        p2_score -= fold;
+
+        bool deuce = (p1_score >= deuce_points) & (p2_score >= deuce_points);
+        bool p1_ahead = p1_score >= p2_score + 2;
+        bool p2_ahead = p2_score >= p1_score + 2;
+        bool p1_reached = p1_score >= win_points;
+        bool p2_reached = (!p1_reached) & (p2_score >= win_points);
+        bool p1_won = (deuce & p1_ahead) | (!deuce & p1_reached);
+        bool p2_won = (!p1_won) & ((deuce & p2_ahead) | (!deuce & p2_reached));
+
+        uint8_t p1_games = _p1_games_won[match];
+        uint8_t p2_games = _p2_games_won[match];
+        _p1_games_won[match] = p1_games + (p1_won & (p1_games < MAX_GAMES_WON));
+        _p2_games_won[match] = p2_games + (p2_won & (p2_games < MAX_GAMES_WON));
+
+        uint8_t keep = -static_cast<uint8_t>(!(p1_won | p2_won));
+        _p1_score[match] = p1_score & keep;
+        _p2_score[match] = p2_score & keep;
+    }
+
+    /**
+     * The fields of every match, indexed by match, as in
+     * basic_table_tennis::game_state.
+     */
+    std::vector<uint8_t> _p1_score;
+    std::vector<uint8_t> _p2_score;
+    std::vector<uint8_t> _p1_games_won;
+    std::vector<uint8_t> _p2_games_won;
+    std::vector<uint8_t> _to_21;
+    std::vector<uint8_t> _p2_serves_first;
+};
+
+#endif /* __TABLE_TENNIS_POOL_HPP__ */
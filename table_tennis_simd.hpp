@@ -0,0 +1,457 @@
+/**
+ * Evaluates the deuce, win and serve rules of table tennis for many games at
+ * once with SIMD instructions, for replaying and simulating matches in bulk on
+ * a host machine.
+ *
+ * @author Aaron Jones <aaron@jonesinator.com>
+ * @license GPLv3
+ */
+
+#ifndef __TABLE_TENNIS_SIMD_HPP__
+#define __TABLE_TENNIS_SIMD_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TABLE_TENNIS_SIMD_X86 1
+#endif
+
+/**
+ * The ways table_tennis_evaluate() can be carried out.
+ */
+enum class table_tennis_kernel {
+    /**
+     * One game at a time, on any machine.
+     */
+    scalar,
+
+    /**
+     * Sixteen games at a time, on x86 machines with SSE2.
+     */
+    sse2,
+
+    /**
+     * Thirty two games at a time, on x86 machines with AVX2.
+     */
+    avx2
+};
+
+/**
+ * The games to evaluate and where to put the results, one byte per game in
+ * each array.
+ */
+struct table_tennis_lanes {
+    /**
+     * The points player one has scored.
+     */
+    const uint8_t* p1_score;
+
+    /**
+     * The points player two has scored.
+     */
+    const uint8_t* p2_score;
+
+    /**
+     * 1 if the game is played to twenty one points, 0 for eleven.
+     */
+    const uint8_t* to_21;
+
+    /**
+     * 1 if player two served first, 0 if player one did.
+     */
+    const uint8_t* p2_serves_first;
+
+    /**
+     * Set to 1 if the game is in deuce, 0 if not.
+     */
+    uint8_t* deuce;
+
+    /**
+     * Set to 1 if player one has won the game, 2 if player two has, 0 if
+     * neither has.
+     */
+    uint8_t* winner;
+
+    /**
+     * Set to 1 if player two is serving, 0 if player one is.
+     */
+    uint8_t* p2_serving;
+};
+
+/**
+ * Evaluates games one at a time, following the same rules as
+ * basic_table_tennis::deuce(), check_for_win() and serve().
+ *
+ * @param lanes The games and results.
+ * @param first The index of the first game to evaluate.
+ * @param count The number of games to evaluate.
+ */
+inline void table_tennis_evaluate_scalar(const table_tennis_lanes& lanes,
+                                         size_t first,
+                                         size_t count) {
+    for (size_t i = first; i < first + count; ++i) {
+        int p1 = lanes.p1_score[i];
+        int p2 = lanes.p2_score[i];
+        bool to_21 = lanes.to_21[i];
+        int deuce_points = to_21 ? 20 : 10;
+        bool deuce = p1 >= deuce_points && p2 >= deuce_points;
+
+        bool p1_won;
+        bool p2_won;
+        if (deuce) {
+            p1_won = p1 >= p2 + 2;
+            p2_won = p2 >= p1 + 2;
+        } else {
+            p1_won = p1 >= deuce_points + 1;
+            p2_won = !p1_won && p2 >= deuce_points + 1;
+        }
+
+        int serve_interval = deuce ? 1 : (to_21 ? 5 : 2);
+        bool p2_serving = ((p1 + p2) / serve_interval) % 2 != 0;
+
+        lanes.deuce[i] = deuce;
+        lanes.winner[i] = p1_won ? 1 : (p2_won ? 2 : 0);
+        lanes.p2_serving[i] = p2_serving != (lanes.p2_serves_first[i] != 0);
+    }
+}
+
+#ifdef TABLE_TENNIS_SIMD_X86
+
+/**
+ * Evaluates eight games held in 16-bit lanes with SSE2. The rules are the same
+ * as table_tennis_evaluate_scalar(), but every case is worked out and the
+ * answer picked with masks. The scores are widened to 16 bits so the sums and
+ * comparisons cannot overflow, and the serve interval of five is divided by
+ * with a multiply.
+ *
+ * @param p1_score        The points player one has scored.
+ * @param p2_score        The points player two has scored.
+ * @param to_21           Nonzero for games played to twenty one points.
+ * @param p2_serves_first Nonzero if player two served first.
+ * @param deuce           Set to 1 for games in deuce.
+ * @param winner          Set to 1 or 2 for games won by player one or two.
+ * @param p2_serving      Set to 1 for games where player two is serving.
+ */
+__attribute__((target("sse2")))
+inline void table_tennis_evaluate_sse2_lanes(__m128i p1_score,
+                                             __m128i p2_score,
+                                             __m128i to_21,
+                                             __m128i p2_serves_first,
+                                             __m128i& deuce,
+                                             __m128i& winner,
+                                             __m128i& p2_serving) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+
+    /**
+     * a >= b is tested as a > b - 1, and a >= b + 2 as a > b + 1.
+     */
+    __m128i to_21_mask = _mm_cmpgt_epi16(to_21, zero);
+    __m128i deuce_less_one = _mm_add_epi16(
+        _mm_set1_epi16(9), _mm_and_si128(to_21_mask, _mm_set1_epi16(10)));
+    __m128i deuce_points = _mm_add_epi16(deuce_less_one, one);
+    __m128i is_deuce = _mm_and_si128(_mm_cmpgt_epi16(p1_score, deuce_less_one),
+                                     _mm_cmpgt_epi16(p2_score, deuce_less_one));
+
+    __m128i p1_ahead = _mm_cmpgt_epi16(p1_score, _mm_add_epi16(p2_score, one));
+    __m128i p2_ahead = _mm_cmpgt_epi16(p2_score, _mm_add_epi16(p1_score, one));
+    __m128i p1_reached = _mm_cmpgt_epi16(p1_score, deuce_points);
+    __m128i p2_reached = _mm_cmpgt_epi16(p2_score, deuce_points);
+    __m128i p1_won = _mm_or_si128(_mm_and_si128(is_deuce, p1_ahead),
+                                  _mm_andnot_si128(is_deuce, p1_reached));
+    __m128i p2_won = _mm_andnot_si128(
+        p1_won,
+        _mm_or_si128(_mm_and_si128(is_deuce, p2_ahead),
+                     _mm_andnot_si128(is_deuce, p2_reached)));
+
+    __m128i total = _mm_add_epi16(p1_score, p2_score);
+    __m128i fifths = _mm_srli_epi16(
+        _mm_mulhi_epu16(total, _mm_set1_epi16(static_cast<short>(0xCCCD))), 2);
+    __m128i halves = _mm_srli_epi16(total, 1);
+    __m128i intervals = _mm_or_si128(
+        _mm_and_si128(is_deuce, total),
+        _mm_andnot_si128(is_deuce,
+                         _mm_or_si128(_mm_and_si128(to_21_mask, fifths),
+                                      _mm_andnot_si128(to_21_mask, halves))));
+    __m128i p2_first = _mm_and_si128(
+        _mm_cmpgt_epi16(p2_serves_first, zero), one);
+
+    deuce = _mm_and_si128(is_deuce, one);
+    winner = _mm_or_si128(_mm_and_si128(p1_won, one),
+                          _mm_and_si128(p2_won, _mm_set1_epi16(2)));
+    p2_serving = _mm_xor_si128(_mm_and_si128(intervals, one), p2_first);
+}
+
+/**
+ * Evaluates games sixteen at a time with SSE2, and any left over one at a
+ * time.
+ *
+ * @param lanes The games and results.
+ * @param first The index of the first game to evaluate.
+ * @param count The number of games to evaluate.
+ */
+__attribute__((target("sse2")))
+inline void table_tennis_evaluate_sse2(const table_tennis_lanes& lanes,
+                                       size_t first,
+                                       size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = first;
+    for (; i + 16 <= first + count; i += 16) {
+        __m128i p1 = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(lanes.p1_score + i));
+        __m128i p2 = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(lanes.p2_score + i));
+        __m128i to_21 = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(lanes.to_21 + i));
+        __m128i p2_first = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(lanes.p2_serves_first + i));
+
+        __m128i deuce_low, winner_low, serving_low;
+        __m128i deuce_high, winner_high, serving_high;
+        table_tennis_evaluate_sse2_lanes(_mm_unpacklo_epi8(p1, zero),
+                                         _mm_unpacklo_epi8(p2, zero),
+                                         _mm_unpacklo_epi8(to_21, zero),
+                                         _mm_unpacklo_epi8(p2_first, zero),
+                                         deuce_low,
+                                         winner_low,
+                                         serving_low);
+        table_tennis_evaluate_sse2_lanes(_mm_unpackhi_epi8(p1, zero),
+                                         _mm_unpackhi_epi8(p2, zero),
+                                         _mm_unpackhi_epi8(to_21, zero),
+                                         _mm_unpackhi_epi8(p2_first, zero),
+                                         deuce_high,
+                                         winner_high,
+                                         serving_high);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.deuce + i),
+                         _mm_packus_epi16(deuce_low, deuce_high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.winner + i),
+                         _mm_packus_epi16(winner_low, winner_high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.p2_serving + i),
+                         _mm_packus_epi16(serving_low, serving_high));
+    }
+    table_tennis_evaluate_scalar(lanes, i, first + count - i);
+}
+
+/**
+ * Evaluates sixteen games held in 16-bit lanes with AVX2, the same way as
+ * table_tennis_evaluate_sse2_lanes().
+ *
+ * @param p1_score        The points player one has scored.
+ * @param p2_score        The points player two has scored.
+ * @param to_21           Nonzero for games played to twenty one points.
+ * @param p2_serves_first Nonzero if player two served first.
+ * @param deuce           Set to 1 for games in deuce.
+ * @param winner          Set to 1 or 2 for games won by player one or two.
+ * @param p2_serving      Set to 1 for games where player two is serving.
+ */
+__attribute__((target("avx2")))
+inline void table_tennis_evaluate_avx2_lanes(__m256i p1_score,
+                                             __m256i p2_score,
+                                             __m256i to_21,
+                                             __m256i p2_serves_first,
+                                             __m256i& deuce,
+                                             __m256i& winner,
+                                             __m256i& p2_serving) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi16(1);
+
+    __m256i to_21_mask = _mm256_cmpgt_epi16(to_21, zero);
+    __m256i deuce_less_one = _mm256_add_epi16(
+        _mm256_set1_epi16(9),
+        _mm256_and_si256(to_21_mask, _mm256_set1_epi16(10)));
+    __m256i deuce_points = _mm256_add_epi16(deuce_less_one, one);
+    __m256i is_deuce = _mm256_and_si256(
+        _mm256_cmpgt_epi16(p1_score, deuce_less_one),
+        _mm256_cmpgt_epi16(p2_score, deuce_less_one));
+
+    __m256i p1_ahead = _mm256_cmpgt_epi16(p1_score,
+                                          _mm256_add_epi16(p2_score, one));
+    __m256i p2_ahead = _mm256_cmpgt_epi16(p2_score,
+                                          _mm256_add_epi16(p1_score, one));
+    __m256i p1_reached = _mm256_cmpgt_epi16(p1_score, deuce_points);
+    __m256i p2_reached = _mm256_cmpgt_epi16(p2_score, deuce_points);
+    __m256i p1_won = _mm256_or_si256(
+        _mm256_and_si256(is_deuce, p1_ahead),
+        _mm256_andnot_si256(is_deuce, p1_reached));
+    __m256i p2_won = _mm256_andnot_si256(
+        p1_won,
+        _mm256_or_si256(_mm256_and_si256(is_deuce, p2_ahead),
+                        _mm256_andnot_si256(is_deuce, p2_reached)));
+
+    __m256i total = _mm256_add_epi16(p1_score, p2_score);
+    __m256i fifths = _mm256_srli_epi16(
+        _mm256_mulhi_epu16(total,
+                           _mm256_set1_epi16(static_cast<short>(0xCCCD))),
+        2);
+    __m256i halves = _mm256_srli_epi16(total, 1);
+    __m256i intervals = _mm256_or_si256(
+        _mm256_and_si256(is_deuce, total),
+        _mm256_andnot_si256(
+            is_deuce,
+            _mm256_or_si256(_mm256_and_si256(to_21_mask, fifths),
+                            _mm256_andnot_si256(to_21_mask, halves))));
+    __m256i p2_first = _mm256_and_si256(
+        _mm256_cmpgt_epi16(p2_serves_first, zero), one);
+
+    deuce = _mm256_and_si256(is_deuce, one);
+    winner = _mm256_or_si256(_mm256_and_si256(p1_won, one),
+                             _mm256_and_si256(p2_won, _mm256_set1_epi16(2)));
+    p2_serving = _mm256_xor_si256(_mm256_and_si256(intervals, one), p2_first);
+}
+
+/**
+ * Narrows two vectors of sixteen 16-bit results, each 0 to 2, to thirty two
+ * bytes in order and stores them.
+ *
+ * @param out  Where to store the bytes.
+ * @param low  The results for the first sixteen games.
+ * @param high The results for the last sixteen games.
+ */
+__attribute__((target("avx2")))
+inline void table_tennis_store_avx2(uint8_t* out, __m256i low, __m256i high) {
+    /**
+     * The pack works within each 128-bit half, which leaves the quarters in
+     * the order low 0, high 0, low 1, high 1.
+     */
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high),
+                                              0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+}
+
+/**
+ * Evaluates games thirty two at a time with AVX2, and any left over one at a
+ * time.
+ *
+ * @param lanes The games and results.
+ * @param first The index of the first game to evaluate.
+ * @param count The number of games to evaluate.
+ */
+__attribute__((target("avx2")))
+inline void table_tennis_evaluate_avx2(const table_tennis_lanes& lanes,
+                                       size_t first,
+                                       size_t count) {
+    size_t i = first;
+    for (; i + 32 <= first + count; i += 32) {
+        __m256i p1 = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(lanes.p1_score + i));
+        __m256i p2 = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(lanes.p2_score + i));
+        __m256i to_21 = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(lanes.to_21 + i));
+        __m256i p2_first = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(lanes.p2_serves_first + i));
+
+        __m256i deuce_low, winner_low, serving_low;
+        __m256i deuce_high, winner_high, serving_high;
+        table_tennis_evaluate_avx2_lanes(
+            _mm256_cvtepu8_epi16(_mm256_castsi256_si128(p1)),
+            _mm256_cvtepu8_epi16(_mm256_castsi256_si128(p2)),
+            _mm256_cvtepu8_epi16(_mm256_castsi256_si128(to_21)),
+            _mm256_cvtepu8_epi16(_mm256_castsi256_si128(p2_first)),
+            deuce_low,
+            winner_low,
+            serving_low);
+        table_tennis_evaluate_avx2_lanes(
+            _mm256_cvtepu8_epi16(_mm256_extracti128_si256(p1, 1)),
+            _mm256_cvtepu8_epi16(_mm256_extracti128_si256(p2, 1)),
+            _mm256_cvtepu8_epi16(_mm256_extracti128_si256(to_21, 1)),
+            _mm256_cvtepu8_epi16(_mm256_extracti128_si256(p2_first, 1)),
+            deuce_high,
+            winner_high,
+            serving_high);
+
+        table_tennis_store_avx2(lanes.deuce + i, deuce_low, deuce_high);
+        table_tennis_store_avx2(lanes.winner + i, winner_low, winner_high);
+        table_tennis_store_avx2(lanes.p2_serving + i,
+                                serving_low,
+                                serving_high);
+    }
+    table_tennis_evaluate_scalar(lanes, i, first + count - i);
+}
+
+#endif /* TABLE_TENNIS_SIMD_X86 */
+
+/**
+ * Checks whether this machine can carry out a kernel.
+ *
+ * @param kernel The kernel.
+ *
+ * @returns True if the kernel can be used.
+ */
+inline bool table_tennis_kernel_supported(table_tennis_kernel kernel) {
+    switch (kernel) {
+        case table_tennis_kernel::scalar:
+            return true;
+#ifdef TABLE_TENNIS_SIMD_X86
+        case table_tennis_kernel::sse2:
+            return __builtin_cpu_supports("sse2");
+        case table_tennis_kernel::avx2:
+            return __builtin_cpu_supports("avx2");
+#else
+        case table_tennis_kernel::sse2:
+        case table_tennis_kernel::avx2:
+            return false;
+#endif
+    }
+    return false;
+}
+
+/**
+ * Gets the fastest kernel this machine can carry out.
+ *
+ * @returns The kernel.
+ */
+inline table_tennis_kernel table_tennis_best_kernel() {
+    if (table_tennis_kernel_supported(table_tennis_kernel::avx2)) {
+        return table_tennis_kernel::avx2;
+    }
+    if (table_tennis_kernel_supported(table_tennis_kernel::sse2)) {
+        return table_tennis_kernel::sse2;
+    }
+    return table_tennis_kernel::scalar;
+}
+
+/**
+ * Evaluates whether games are in deuce, who has won them and who is serving
+ * with a particular kernel. The kernel must be supported by this machine.
+ *
+ * @param kernel The kernel to use.
+ * @param lanes  The games and results.
+ * @param count  The number of games.
+ */
+inline void table_tennis_evaluate(table_tennis_kernel kernel,
+                                  const table_tennis_lanes& lanes,
+                                  size_t count) {
+    switch (kernel) {
+#ifdef TABLE_TENNIS_SIMD_X86
+        case table_tennis_kernel::avx2:
+            table_tennis_evaluate_avx2(lanes, 0, count);
+            return;
+        case table_tennis_kernel::sse2:
+            table_tennis_evaluate_sse2(lanes, 0, count);
+            return;
+#endif
+        default:
+            table_tennis_evaluate_scalar(lanes, 0, count);
+            return;
+    }
+}
+
+/**
+ * Evaluates whether games are in deuce, who has won them and who is serving
+ * with the fastest kernel this machine supports, which is chosen on the first
+ * call.
+ *
+ * @param lanes The games and results.
+ * @param count The number of games.
+ */
+inline void table_tennis_evaluate(const table_tennis_lanes& lanes,
+                                  size_t count) {
+    static const table_tennis_kernel kernel = table_tennis_best_kernel();
+    table_tennis_evaluate(kernel, lanes, count);
+}
+
+#endif /* __TABLE_TENNIS_SIMD_HPP__ */